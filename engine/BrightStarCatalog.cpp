@@ -34,54 +34,84 @@
 //#include "f32file.h"
 #include "BrightStarCatalog.h"
 #include "r3/filesystem.h"
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 
 using namespace r3;
 using namespace std;
 
+namespace {
+	// Each record in the "stars" file is three doubles: ra, dec, mag.
+	const int RecordSize = 8 * 3;
+	
+	// Simple strided loops over plain arrays so the compiler can vectorize them.
+	void ConvertColumn( const double *src, int count, float *dst ) {
+		for ( int i = 0; i < count; i++ ) {
+			dst[ i ] = float( src[ i * 3 ] );
+		}
+	}
+	
+	void ComputeUnitVectors( const float *ra, const float *dec, int count, Vec3f *dir ) {
+		for ( int i = 0; i < count; i++ ) {
+			float cd = cosf( dec[ i ] );
+			dir[ i ].x = cd * cosf( ra[ i ] );
+			dir[ i ].y = cd * sinf( ra[ i ] );
+			dir[ i ].z = sinf( dec[ i ] );
+		}
+	}
+}
+
 bool 
 BrightStarCatalog::Initialized()
 {
-	if ( stars.size() > 0 ) {
+	if ( ra.size() > 0 ) {
 		return true;
 	}
 	
-	File *file = FileOpenForRead( "stars" );
-	if (file == NULL )
-	{
+	// one read for the whole file instead of one per star
+	vector< uchar > data;
+	if ( FileReadToMemory( "stars", data ) == false ) {
 		return false;
 	}
 
-	int len = file->Size() / (8 * 3);
-	for ( int i = 0; i < len; i++ ) {
-		double vals[3]; 
-		file->Read( vals, 8, 3 );
-		Star s;
-		s.ra = float( vals[0] );
-		s.dec = float( vals[1] );
-		s.mag = float( vals[2] );
-		stars.push_back( s );
+	int len = (int)data.size() / RecordSize;
+	if ( len == 0 ) {
+		return false;
 	}
-	delete file;
+	
+	// copy into aligned storage, the byte vector has no alignment guarantee for doubles
+	vector< double > vals( len * 3 );
+	memcpy( &vals[0], &data[0], len * RecordSize );
+	
+	ra.resize( len );
+	dec.resize( len );
+	magnitude.resize( len );
+	dir.resize( len );
+	
+	ConvertColumn( &vals[0] + 0, len, &ra[0] );
+	ConvertColumn( &vals[0] + 1, len, &dec[0] );
+	ConvertColumn( &vals[0] + 2, len, &magnitude[0] );
+	ComputeUnitVectors( &ra[0], &dec[0], len, &dir[0] );
 	return true;
 }
 
 float
 BrightStarCatalog::rightAscensionInRadians(int i)
 {
-	return stars[ i ].ra;
+	return ra[ i ];
 }
 
 float
 BrightStarCatalog::declinationInRadians(int i)
 {
-	return stars[ i ].dec;
+	return dec[ i ];
 }
 
 float
 BrightStarCatalog::mag(int i)
 {
-	return stars[ i ].mag;
+	return magnitude[ i ];
 }
 
@@ -26,6 +26,8 @@
 
 #include <vector>
 
+#include "r3/linear.h"
+
 /*
   The 518 brightest stars, from the Yale Bright Star Catalog, BSC5.
   These are all the stars brighter than 4th magnitude.
@@ -36,18 +38,25 @@ class BrightStarCatalog
 public:
 	bool Initialized();
 	int GetSize() {
-		return (int)stars.size();
+		return (int)ra.size();
 	}
   	float rightAscensionInRadians(int i);
   	float declinationInRadians(int i);
   	float mag(int i);
+
+	// unit vectors in the same frame as star3map::SphericalToCartesian
+	const r3::Vec3f & unitVector(int i) {
+		return dir[ i ];
+	}
+	const r3::Vec3f * unitVectors() {
+		return dir.size() ? &dir[0] : NULL;
+	}
 private:
-	struct Star {
-		float ra;
-		float dec;
-		float mag;
-	};
-	std::vector<Star> stars;
+	// structure of arrays, sized once from the file length
+	std::vector<float> ra;
+	std::vector<float> dec;
+	std::vector<float> magnitude;
+	std::vector<r3::Vec3f> dir;
 };
 
-#endif //__BRIGHTSTARCATALOG_DEF__
\ No newline at end of file
+#endif //__BRIGHTSTARCATALOG_DEF__
\ No newline at end of file
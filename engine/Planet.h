@@ -145,7 +145,7 @@ public:
 				texname.push_back( tolower( name[ i ] ) );
 			}
 			texname += ".jpg";
-			texture = r3::CreateTexture2DFromFile( texname.c_str(), r3::TextureFormat_RGBA );
+			texture = r3::CreateTexture2DFromFileAsync( texname.c_str(), r3::TextureFormat_RGBA );
 			scale = 1.0f;
 		}
 	}
@@ -50,7 +50,7 @@ namespace {
 		if ( initialized ) {
 			return;
 		}
-		star0 = r3::CreateTexture2DFromFile("startex.jpg", TextureFormat_RGBA );
+		star0 = r3::CreateTexture2DFromFileAsync("startex.jpg", TextureFormat_RGBA );
 		
 		struct tm epoch_tm, curr_tm;
 		time_t gmt = time_t( GetTime() );
@@ -64,7 +64,7 @@ namespace {
 		epoch_tm.tm_year = 2000 - 1900;
 		epoch_tm.tm_isdst = -1; // timegm() will try to figure it out if negative
 
-#if __APPLE__
+#if __APPLE__ || __linux__
 		// we operate on gmtime only...
 		setenv( "TZ", "", 1 );
 		tzset();
@@ -163,7 +163,7 @@ void CPlanetFinderEngine::initPlanets()
 	planets[7] = &neptune; 
 	planets[8] = &pluto;
 
-	sunTexture = CreateTexture2DFromFile( "sun.jpg", TextureFormat_RGBA );
+	sunTexture = CreateTexture2DFromFileAsync( "sun.jpg", TextureFormat_RGBA );
 };
 
    	
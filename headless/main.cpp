@@ -0,0 +1,262 @@
+/*
+ *  planet_finder headless benchmark main
+ *
+ * Copyright (c) 2010 Cass Everitt
+ * All rights reserved.
+ *
+ */
+
+/*  This file is a part of PlanetFinder. PlanetFinder is a Series 60 application
+ for locating the planets in the sky. It is a porting of a Java Applet by 
+ Benjamin Crowell to the Series 60 Developer Platform. See 
+ http://www.lightandmatter.com/area2planet.shtml for the original version.
+ Java Applet: Copyright (C) 2000, Benjamin Crowell
+ Series 60 Version: Copyright (C) 2004, Kostas Giannakakis
+ 
+ PlanetFinder is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+ 
+ PlanetFinder is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public License
+ along with PlanetFinder; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// A platform with no window and no GL context.  The record backend stands
+// in for GL, and the benchmark command draws frames of each view back to
+// back, e.g.
+//   star3map_headless +set app_benchmarkFrames 500 +set app_latitude 51.5
+// Setting app_chartJobs renders the charts it lists instead, see SkyChart().
+
+#include "r3/command.h"
+#include "r3/filesystem.h"
+#include "r3/common.h"
+#include "r3/var.h"
+#include "r3/init.h"
+#include "r3/texture.h"
+#include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/time.h"
+#include "r3/trace.h"
+
+
+#include "starlist.h"
+#include "constellations.h"
+#include "render.h"
+#include "starcatalog.h"
+#include "star3map.h"
+#include "skyraster.h"
+
+#include <map>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+using namespace r3;
+using namespace star3map;
+
+VarInteger r_windowWidth( "r_windowWidth", "window width", Var_ReadOnly, 320 );
+VarInteger r_windowHeight( "r_windowHeight", "window height", Var_ReadOnly, 480 );
+
+VarFloat r_fov( "r_fov", "perspective field of view", 0, 75.0f );
+
+VarFloat app_latitude( "app_latitude", "viewer current latitude", 0, 35.0f );
+VarFloat app_longitude( "app_longitude", "viewer current longitude", 0, -77.0f );
+VarFloat app_phaseEarthRotation( "app_phaseEarthRotation", "time based earth rotation", Var_ReadOnly, 0.0f );
+
+VarBool app_cull( "app_cull", "cull stars that are outside the current view", 0, true );
+
+VarInteger app_benchmarkFrames( "app_benchmarkFrames", "frames drawn for each view by the headless benchmark", 0, 100 );
+
+VarString app_chartJobs( "app_chartJobs", "job file for offscreen sky charts, rendered instead of the benchmark", 0, "" );
+VarInteger app_chartWidth( "app_chartWidth", "offscreen sky chart width", 0, 1024 );
+VarInteger app_chartHeight( "app_chartHeight", "offscreen sky chart height", 0, 768 );
+VarFloat app_chartFov( "app_chartFov", "offscreen sky chart vertical field of view", 0, 90.0f );
+VarInteger app_chartTileSize( "app_chartTileSize", "offscreen sky chart tile size in pixels", 0, 64 );
+VarInteger app_chartThreads( "app_chartThreads", "offscreen sky chart rasterizer threads, 0 for one per processor", 0, 0 );
+VarInteger app_chartBatch( "app_chartBatch", "offscreen sky charts held in memory at once", 0, 16 );
+
+extern VarFloat t_bias;
+
+extern vector< Sprite > stars;
+extern vector< Sprite > solarsystem;
+extern vector< Lines > constellations;
+extern StarCatalog starCatalog;
+
+r3::Texture2D *startex;
+
+
+#include "engine/PlanetFinderEngine.h"
+CPlanetFinderEngine planetFinder;
+TPlanetFinderSettings settings;
+
+r3::Matrix4f platformOrientation;
+
+void UpdateLatLon() {
+	settings.iLatitude = app_latitude.GetVal();
+	settings.iLongitude = app_longitude.GetVal();
+	planetFinder.Init( settings );
+}
+
+struct ChartJob {
+	double time;   // UTC, seconds since 1970
+	float latitude;
+	float longitude;
+	float theta;   // as app_manualTheta
+	float phi;     // as app_manualPhi
+	string filename;
+};
+
+bool ParseChartJob( const string & line, ChartJob & job ) {
+	struct tm t;
+	memset( & t, 0, sizeof( t ) );
+	char fn[256];
+	if ( sscanf( line.c_str(), "%d-%d-%dT%d:%d:%d %f %f %f %f %255s",
+				&t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min, &t.tm_sec,
+				&job.latitude, &job.longitude, &job.theta, &job.phi, fn ) != 11 ) {
+		return false;
+	}
+	t.tm_year -= 1900;
+	t.tm_mon -= 1;
+#if _WIN32
+	job.time = _mkgmtime( & t );
+#else
+	job.time = timegm( & t );
+#endif
+	job.filename = fn;
+	return true;
+}
+
+ProfileTimer chartBatchTimer( "chartBatch" );
+
+// each batch counts as a frame for the profiler and trace captures
+void RenderChartBatch( vector< SkyScene * > & scenes ) {
+	ProfileScope ps( chartBatchTimer );
+	RasterizeSkyScenes( scenes, app_chartTileSize.GetVal(), app_chartThreads.GetVal() );
+	for ( int i = 0; i < (int)scenes.size(); i++ ) {
+		if ( scenes[i]->WritePng( scenes[i]->filename ) == false ) {
+			Output( "Unable to write %s.", scenes[i]->filename.c_str() );
+		}
+		delete scenes[i];
+	}
+	scenes.clear();
+	ProfileFrame();
+}
+
+void ReportProfile() {
+	r3::ExecuteCommand( "renderstats" );
+	r3::ExecuteCommand( "memreport" );
+	if ( r3::profileEnabled ) {
+		r3::ExecuteCommand( "listtimers" );
+	}
+	if ( r3::TraceAvailable() ) {
+		r3::ExecuteCommand( "tracedump" );
+	}
+}
+
+// Each non-blank line of the job file that does not start with # is
+//   <YYYY-MM-DDTHH:MM:SS UTC> <latitude> <longitude> <theta> <phi> <output.png>
+// Scenes are set up one after another, and each batch of app_chartBatch
+// is rasterized in parallel.  Images are written to the cache directory.
+void SkyChart( const string & jobFile ) {
+	File *f = FileOpenForRead( jobFile );
+	if ( f == NULL ) {
+		Output( "Unable to open chart job file %s.", jobFile.c_str() );
+		return;
+	}
+	vector< ChartJob > jobs;
+	while ( f->AtEnd() == false ) {
+		string line = f->ReadLine();
+		if ( line.size() == 0 || line[0] == '#' ) {
+			continue;
+		}
+		ChartJob job;
+		if ( ParseChartJob( line, job ) ) {
+			jobs.push_back( job );
+		} else {
+			Output( "Skipping bad chart job: %s", line.c_str() );
+		}
+	}
+	delete f;
+	
+	double t0 = GetTime();
+	float lat = app_latitude.GetVal();
+	float lon = app_longitude.GetVal();
+	vector< SkyScene * > scenes;
+	for ( int i = 0; i < (int)jobs.size(); i++ ) {
+		ChartJob & job = jobs[i];
+		t_bias.SetVal( float( ( job.time - GetTime() ) / 3600.0 ) );
+		app_latitude.SetVal( job.latitude );
+		app_longitude.SetVal( job.longitude );
+		UpdateLatLon();
+		app_phaseEarthRotation.SetVal( GetPhaseEarthRotation() );
+		planetFinder.buildSolarSystemList( solarsystem );
+		
+		SkyScene *scene = new SkyScene( app_chartWidth.GetVal(), app_chartHeight.GetVal() );
+		scene->filename = job.filename;
+		CaptureSkyScene( *scene, ManualOrientation( job.phi, job.theta ), app_chartFov.GetVal() );
+		scenes.push_back( scene );
+		if ( (int)scenes.size() >= max( 1, app_chartBatch.GetVal() ) ) {
+			RenderChartBatch( scenes );
+		}
+	}
+	RenderChartBatch( scenes );
+	
+	t_bias.SetVal( 0 );
+	app_latitude.SetVal( lat );
+	app_longitude.SetVal( lon );
+	UpdateLatLon();
+	Output( "Rendered %d charts in %.2f s.", (int)jobs.size(), GetTime() - t0 );
+}
+
+void SkyChartCommand( const vector< Token > & tokens ) {
+	if ( tokens.size() != 2 ) {
+		Output( "usage: skychart <jobfile>" );
+		return;
+	}
+	SkyChart( tokens[1].valString );
+}
+CommandFunc SkyChartCmd( "skychart", "renders the sky charts listed in a job file", SkyChartCommand );
+
+int main( int argc, char ** argv ) {
+	// before Init, so +set r_backend gl on the command line still wins
+	r3::ExecuteCommand( "set r_backend record" );
+	// every frame measured should have its textures
+	r3::ExecuteCommand( "set r_asyncTextureLoads 0" );
+	r3::Init( argc, argv );
+	
+	startex = r3::CreateTexture2DFromFile( "startex.jpg", TextureFormat_RGBA );
+	star3map::LoadSky( startex );
+	
+	planetFinder.Construct();
+	UpdateLatLon();
+	planetFinder.SetSize( r_windowWidth.GetVal(), r_windowHeight.GetVal() );
+	platformOrientation.MakeIdentity();
+	app_phaseEarthRotation.SetVal( GetPhaseEarthRotation() );
+	planetFinder.buildSolarSystemList( solarsystem );
+	
+	if ( app_chartJobs.GetVal().size() > 0 ) {
+		SkyChart( app_chartJobs.GetVal() );
+		ReportProfile();
+		return 0;
+	}
+	
+	char cmd[64];
+	sprintf( cmd, "benchmark %d stars", app_benchmarkFrames.GetVal() );
+	r3::ExecuteCommand( cmd );
+	sprintf( cmd, "benchmark %d globe", app_benchmarkFrames.GetVal() );
+	r3::ExecuteCommand( cmd );
+	r3::ExecuteCommand( "recordstats" );
+	ReportProfile();
+	
+	return 0;
+}
@@ -14,6 +14,8 @@
 #include "r3/draw.h"
 #include "r3/init.h"
 #include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/texture.h"
 
 #ifdef __APPLE__
 # include <TargetConditionals.h>
@@ -34,6 +36,7 @@
 #include "starlist.h"
 #include "constellations.h"
 #include "render.h"
+#include "starcatalog.h"
 #include "star3map.h"
 
 #include <map>
@@ -63,6 +66,7 @@ extern VarBool app_useCoreLocation;
 extern vector< Sprite > stars;
 extern vector< Sprite > solarsystem;
 extern vector< Lines > constellations;
+extern StarCatalog starCatalog;
 
 r3::Texture2D *startex;
 
@@ -86,6 +90,10 @@ Matrix4f platformOrientation;
 float platformLat;
 float platformLon;
 
+ProfileTimer orientationTimer( "updateOrientation" );
+ProfileTimer solarSystemTimer( "buildSolarSystemList" );
+ProfileTimer consoleDrawTimer( "console.Draw" );
+
 void UpdateLatLon() {
 	//Output( "lat = %.2f, lon = %.2f", latlon.x, latlon.y );
 	if ( app_useCoreLocation.GetVal() ) {
@@ -143,18 +151,34 @@ void updateOrientation() {
 
 
 void display() {
-	updateOrientation();
+	UploadLoadedTextures();
+	{
+		ProfileScope ps( orientationTimer );
+		updateOrientation();
+	}
 	app_phaseEarthRotation.SetVal( GetPhaseEarthRotation() );
-	planetFinder.buildSolarSystemList( solarsystem );
+	if ( star3map::NeedsDisplay() == false ) {
+		// without a present the last frame stays up
+		return;
+	}
+	{
+		ProfileScope ps( solarSystemTimer );
+		planetFinder.buildSolarSystemList( solarsystem );
+	}
 	star3map::Display();
 
 	glPushMatrix();
 	glLoadIdentity();
 	glOrtho(0, r_windowWidth.GetVal(), 0, r_windowHeight.GetVal(), -1, 1 );
-	r3::console.Draw();
+	{
+		ProfileScope ps( consoleDrawTimer );
+		r3::console.Draw();
+	}
+	DrawProfileOverlay();
 	glPopMatrix();
 		
 	SwapBuffers();
+	ProfileFrame();
 }
 
 void reshape( int width, int height ) {
@@ -282,67 +306,9 @@ void platformMain () {
 	planetFinder.Construct();
 	planetFinder.Init( settings );
 	
-	startex = r3::CreateTexture2DFromFile("startex.jpg", TextureFormat_RGBA );
-	
-	{
-		float starColors [] = {
-			0.8, 0.8, 1.0, // blue
-			1.0, 1.0, 0.8, // light yellow
-			1.0, 1.0, 0.6, // yellow
-			1.0, 0.8, 0.4, // orange
-			1.0, 0.6, 0.3  // red
-		};
-		vector< star3map::Star > sl;
-		ReadStarList( "stars.txt", sl );
-		map<int, star3map::Star *> sm;
-		for ( int i = 0; i < (int)sl.size(); i++ ) {
-			Sprite sp;
-			star3map::Star & st = sl[i];
-			sm[ st.hipnum ] = & st;
-			sp.direction = SphericalToCartesian( 1.0f, ToRadians( st.dec ), ToRadians( st.ra ) );
-			sp.magnitude = st.mag;
-			sp.scale = 1.0f;
-			sp.tex = startex;
-			sp.name = st.name;
-			float f = 3.99f * max( 0.f, min( 1.0f, float( ( st.colorIndex + 0.29 ) / ( 1.41 + 0.29 ) )  ) );
-			int ind = f;
-			float phase = f - ind;
-			ind *= 3;
-			Vec3f c0( starColors + ind );
-			Vec3f c1( starColors + ind + 3 );
-			Vec3f c = c0 * ( 1 - phase ) + c1 * phase;
-			sp.color = Vec4f( c.x, c.y, c.z, 1 );
-			stars.push_back( sp );
-		}		
-		vector< star3map::Constellation > cl;
-		ReadConstellations( "constellations.txt", cl );
-		for( int i = 0; i < (int)cl.size(); i++ ) {
-			star3map::Constellation & c = cl[ i ];
-			star3map::Lines lines;
-			lines.name = c.name;
-			lines.center = Vec3f( 0, 0, 0 );
-			for ( int j = 0; j < (int)c.indexes.size(); j+=2 ) {
-				if ( sm.count( c.indexes[ j + 0 ] ) && sm.count( c.indexes[j + 1 ] ) ) {
-					for ( int k = 0; k < 2; k++ ) {
-						star3map::Star *s = sm[ c.indexes[ j + k ] ];
-						lines.vert.push_back( SphericalToCartesian( 1.0, ToRadians( s->dec ), ToRadians( s->ra ) ) );
-						lines.center += lines.vert.back();
-					}
-				} else {
-					Output( "One of the following constellation indexes was not found: %d, %d.", c.indexes[j], c.indexes[j+1] );
-				}
-			}
-			lines.center.Normalize();
-			lines.limit = 1.0f;
-			for ( int j = 0; j < (int)lines.vert.size(); j++ ) {
-				lines.limit = min( lines.limit, lines.center.Dot( lines.vert[ j ] ) );
-			}
-			constellations.push_back( lines );
-		}
-		
-	}
-	
+	startex = r3::CreateTexture2DFromFileAsync("startex.jpg", TextureFormat_RGBA );
 	
+	star3map::LoadSky( startex );
 	
 	glClearColor(0, 0, 0, 0);
 }
@@ -49,6 +49,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <string.h>
 
 using namespace std;
 
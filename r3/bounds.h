@@ -117,6 +117,19 @@ namespace r3 {
 		Vec2f vert[4];
 	};
 	
+	inline Bounds2f GetBounds( const OrientedBounds2f & ob ) {
+		Bounds2f b;
+		for ( int i = 0; i < 4; i++ ) {
+			b.Add( ob.vert[ i ] );
+		}
+		return b;
+	}
+	
+	inline bool Overlap( const Bounds2f & a, const Bounds2f & b ) {
+		return a.Min().x <= b.Max().x && b.Min().x <= a.Max().x &&
+			   a.Min().y <= b.Max().y && b.Min().y <= a.Max().y;
+	}
+	
 	inline bool Intersect( const OrientedBounds2f & a, const OrientedBounds2f & b ) {
 		int ind[] = { 0, 1, 2, 3, 0 };
 
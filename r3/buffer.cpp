@@ -45,7 +45,10 @@
 
 #include "r3/command.h"
 #include "r3/draw.h"
+#include "r3/memtrack.h"
 #include "r3/output.h"
+#include "r3/record.h"
+#include "r3/renderstats.h"
 
 #include "r3/gl.h"
 
@@ -80,6 +83,12 @@ namespace {
 	
 	int modBindTarget = GL_ARRAY_BUFFER; // what location is used for "bind for modification"?
 	
+	GLenum ToUsage[] = {
+		GL_STATIC_DRAW,   // BufferUsage_Static
+		GL_DYNAMIC_DRAW,  // BufferUsage_Dynamic
+		GL_STREAM_DRAW    // BufferUsage_Stream
+	};
+	
 	// listbuffers command
 	void ListBuffers( const vector< Token > & tokens ) {
 		if ( bufferDatabase == NULL ) {
@@ -91,6 +100,7 @@ namespace {
 			Buffer * b = it->second;
 			Output( "%s - sz=%d", n.c_str(), b->GetSize() );					
 		}
+		Output( "%d buffers, %d KB", (int)buffers.size(), MemoryTotal( MemoryCategory_Buffer ) >> 10 );
 	}
 	CommandFunc ListBuffersCmd( "listbuffers", "lists defined buffers", ListBuffers );
 	
@@ -110,36 +120,58 @@ namespace r3 {
 		initialized = true;
 	}
 	
-	Buffer::Buffer( const std::string & bufName, int bufTarget ) : name( bufName ), target( bufTarget ) {
-		glGenBuffers( 1, & obj );
+	Buffer::Buffer( const std::string & bufName, int bufTarget ) : name( bufName ), size( 0 ), target( bufTarget ) {
+		if ( Recording() ) {
+			obj = RecordGenObject();
+			Record( RecordOp_GenBuffer, target, obj );
+		} else {
+			glGenBuffers( 1, & obj );
+		}
 		bufferDatabase->AddBuffer( name, this );
 	}
 	Buffer::~Buffer() {
-		glDeleteBuffers( 1, & obj );
+		MemoryTrack( MemoryCategory_Buffer, name, 0 );
+		StateDeleteBuffer( obj );
+		if ( Recording() ) {
+			Record( RecordOp_DeleteBuffer, target, obj );
+		} else {
+			glDeleteBuffers( 1, & obj );
+		}
 		bufferDatabase->DeleteBuffer( name );
 	}
 	
 	void Buffer::Bind() const {
-		glBindBuffer( target, obj );
+		StateBindBuffer( target, obj );
 	}
 	
 	void Buffer::Unbind() const {
-		glBindBuffer( target, 0 );		
+		StateBindBuffer( target, 0 );
 	}
 	
 	
-	void Buffer::SetData( int sz, const void * data ) {
+	void Buffer::SetData( int sz, const void * data, BufferUsageEnum usage ) {
 		size = sz;
-		glBindBuffer( modBindTarget, obj );
-		glBufferData( modBindTarget, size, data, GL_STATIC_DRAW );
-		glBindBuffer( modBindTarget, 0 );
+		MemoryTrack( MemoryCategory_Buffer, name, size );
+		StateBindBuffer( modBindTarget, obj );
+		if ( data ) {
+			CountRenderStat( RenderStat_BufferBytes, size );
+		}
+		if ( Recording() ) {
+			Record( RecordOp_BufferData, target, ToUsage[ usage ], size );
+			return;
+		}
+		glBufferData( modBindTarget, size, data, ToUsage[ usage ] );
 	}
 	
 	void Buffer::SetSubdata( int offset, int sz, const void * data ) {
 		assert( ( offset + sz ) <= size );
-		glBindBuffer( modBindTarget, obj );
+		StateBindBuffer( modBindTarget, obj );
+		CountRenderStat( RenderStat_BufferBytes, sz );
+		if ( Recording() ) {
+			Record( RecordOp_BufferSubData, target, offset, sz );
+			return;
+		}
 		glBufferSubData( modBindTarget, offset, sz, data );
-		glBindBuffer( modBindTarget, 0 );
 	}
 	
 	void Buffer::GetData( void * data ) {
@@ -150,60 +182,95 @@ namespace r3 {
 		assert( 0 ); // unimplemented
 	}
 	
-	VertexBuffer::VertexBuffer( const std::string & vbName ) : Buffer( vbName, GL_ARRAY_BUFFER ) {}
+	VertexBuffer::VertexBuffer( const std::string & vbName ) : Buffer( vbName, GL_ARRAY_BUFFER ), rangeOffset( 0 ), rangeVerts( -1 ) {}
 	void VertexBuffer::SetVarying( int vbVarying ) { varying = vbVarying; }
 	int VertexBuffer::GetNumVerts() const {
+		if ( rangeVerts >= 0 ) {
+			return rangeVerts;
+		}
 		int vsz = GetVertexSize( varying );
 		int numVerts = size / vsz;
 		return numVerts;
 	}
+	
+	void VertexBuffer::SetRange( int byteOffset, int numVerts ) {
+		assert( byteOffset + numVerts * GetVertexSize( varying ) <= size );
+		rangeOffset = byteOffset;
+		rangeVerts = numVerts;
+	}
+	
+	void VertexBuffer::ClearRange() {
+		rangeOffset = 0;
+		rangeVerts = -1;
+	}
 
-	void VertexBuffer::Enable() const {
+	void VertexBuffer::Enable( int firstVert ) const {
 		int stride;
 		int offsets[ R3_NUM_VARYINGS ];
 		ComputeOffsets( varying, stride, offsets );
+		for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+			offsets[ i ] += rangeOffset + firstVert * stride;
+		}
 		if ( varying & Varying_PositionBit ) {
-			glEnableClientState( GL_VERTEX_ARRAY );
-			glVertexPointer( 3, GL_FLOAT, stride, (void *)offsets[0] );
+			StateClientArray( Varying_PositionBit, true );
+			if ( StateArrayPointer( Varying_PositionBit, stride, offsets[0] ) ) {
+				if ( Recording() ) {
+					Record( RecordOp_ArrayPointer, GL_VERTEX_ARRAY, offsets[0] );
+				} else {
+					glVertexPointer( 3, GL_FLOAT, stride, (void *)offsets[0] );
+				}
+			}
 		}
 		if ( varying & Varying_ColorBit ) {
-			glEnableClientState( GL_COLOR_ARRAY );
-			glColorPointer( 4, GL_UNSIGNED_BYTE, stride, (void *)offsets[1] );
+			StateClientArray( Varying_ColorBit, true );
+			if ( StateArrayPointer( Varying_ColorBit, stride, offsets[1] ) ) {
+				if ( Recording() ) {
+					Record( RecordOp_ArrayPointer, GL_COLOR_ARRAY, offsets[1] );
+				} else {
+					glColorPointer( 4, GL_UNSIGNED_BYTE, stride, (void *)offsets[1] );
+				}
+			}
 		}
 		if ( varying & Varying_NormalBit ) {
-			glEnableClientState( GL_NORMAL_ARRAY );			
-			glNormalPointer( GL_FLOAT, stride, (void *)offsets[2] );
+			StateClientArray( Varying_NormalBit, true );
+			if ( StateArrayPointer( Varying_NormalBit, stride, offsets[2] ) ) {
+				if ( Recording() ) {
+					Record( RecordOp_ArrayPointer, GL_NORMAL_ARRAY, offsets[2] );
+				} else {
+					glNormalPointer( GL_FLOAT, stride, (void *)offsets[2] );
+				}
+			}
 		}
 		if ( varying & Varying_TexCoord0Bit ) {
-			glClientActiveTexture( GL_TEXTURE0 );
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, stride, (void *)offsets[3] );
+			StateClientArray( Varying_TexCoord0Bit, true );
+			if ( StateArrayPointer( Varying_TexCoord0Bit, stride, offsets[3] ) ) {
+				StateClientActiveTexture( 0 );
+				if ( Recording() ) {
+					Record( RecordOp_ArrayPointer, GL_TEXTURE_COORD_ARRAY, offsets[3] );
+				} else {
+					glTexCoordPointer( 2, GL_FLOAT, stride, (void *)offsets[3] );
+				}
+			}
 		}
 		if ( varying & Varying_TexCoord1Bit ) {
-			glClientActiveTexture( GL_TEXTURE1 );
-			glEnableClientState( GL_TEXTURE_COORD_ARRAY );			
-			glTexCoordPointer( 2, GL_FLOAT, stride, (void *)offsets[4] );
+			StateClientArray( Varying_TexCoord1Bit, true );
+			if ( StateArrayPointer( Varying_TexCoord1Bit, stride, offsets[4] ) ) {
+				StateClientActiveTexture( 1 );
+				if ( Recording() ) {
+					Record( RecordOp_ArrayPointer, GL_TEXTURE_COORD_ARRAY, offsets[4] );
+				} else {
+					glTexCoordPointer( 2, GL_FLOAT, stride, (void *)offsets[4] );
+				}
+			}
 		}		
 	}
 	
 	void VertexBuffer::Disable() const {
-		if ( varying & Varying_PositionBit ) {
-			glDisableClientState( GL_VERTEX_ARRAY );
-		}
-		if ( varying & Varying_ColorBit ) {
-			glDisableClientState( GL_COLOR_ARRAY );			
-		}
-		if ( varying & Varying_NormalBit ) {
-			glDisableClientState( GL_NORMAL_ARRAY );			
-		}
-		if ( varying & Varying_TexCoord0Bit ) {
-			glClientActiveTexture( GL_TEXTURE0 );
-			glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+			if ( varying & ( 1 << i ) ) {
+				StateClientArray( VaryingEnum( 1 << i ), false );
+			}
 		}
-		if ( varying & Varying_TexCoord1Bit ) {
-			glClientActiveTexture( GL_TEXTURE1 );
-			glDisableClientState( GL_TEXTURE_COORD_ARRAY );			
-		}		
 	}
 	
 	IndexBuffer::IndexBuffer( const std::string & ibName ) : Buffer( ibName, GL_ELEMENT_ARRAY_BUFFER ) {}
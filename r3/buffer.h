@@ -50,6 +50,12 @@
 namespace r3 {
 	
 	void InitBuffer();
+	
+	enum BufferUsageEnum {
+		BufferUsage_Static,
+		BufferUsage_Dynamic,
+		BufferUsage_Stream
+	};
 		
 	class Buffer {
 	protected:
@@ -70,7 +76,8 @@ namespace r3 {
 
 		int GetSize() const { return size; }
 
-		void SetData( int size, const void * data );
+		// data may be NULL to allocate (or orphan) storage
+		void SetData( int size, const void * data, BufferUsageEnum usage = BufferUsage_Static );
 		void SetSubdata( int offset, int size, const void * data );
 		
 		void GetData( void * data );
@@ -80,13 +87,21 @@ namespace r3 {
 	
 	class VertexBuffer : public Buffer {
 		int varying;
+		int rangeOffset;
+		int rangeVerts;
 	public:
 		VertexBuffer( const std::string & vbName );
 		void SetVarying( int vbVarying );
 		int GetVarying() const { return varying; }
 		int GetNumVerts() const;
 		
-		void Enable() const;
+		// Restrict drawing to numVerts vertices starting at byteOffset,
+		// for buffers that hold more than one batch.
+		void SetRange( int byteOffset, int numVerts );
+		void ClearRange();
+		
+		// firstVert offsets the arrays, for drawing large buffers in pieces
+		void Enable( int firstVert = 0 ) const;
 		void Disable() const;
 		
 	};
@@ -44,6 +44,7 @@
 #define __R3_COMMON_H__
 
 #include <string>
+#include <stdio.h>
 
 #define ARRAY_ELEMENTS( a ) ( sizeof( a ) / sizeof ( a[0] ) )
 
@@ -51,6 +51,8 @@
 #include "r3/font.h"
 #include "r3/draw.h"
 
+#include <stdio.h>
+
 using namespace std;
 using namespace r3;
 
@@ -200,6 +202,9 @@ namespace r3 {
 		if ( outputBuffer.size() > con_scrollBuffer.GetVal() ) {
 			outputBuffer.pop_front();
 		}		
+		if ( active ) {
+			RequestRedraw();
+		}
 	}
 	
 	void Console::ProcessKeyEvent( int key, KeyStateEnum keyState ) {
@@ -47,8 +47,12 @@
 #include "r3/common.h"
 #include "r3/gl.h"
 #include "r3/output.h"
+#include "r3/record.h"
+#include "r3/renderstats.h"
+#include "r3/var.h"
 
 
+#include <algorithm>
 #include <assert.h>
 
 #define IM_QUADS 999
@@ -58,6 +62,9 @@
 using namespace std;
 using namespace r3;
 
+VarInteger r_glStateIssued( "r_glStateIssued", "shadowed GL state changes passed to GL", Var_ReadOnly, 0 );
+VarInteger r_glStateSkipped( "r_glStateSkipped", "shadowed GL state changes skipped as redundant", Var_ReadOnly, 0 );
+
 namespace {
 	GLenum ToPrim[] = {
 		PRIM_INVALID,
@@ -94,8 +101,10 @@ namespace {
 	// uniform color - we don't have any other attribs that can be uniform...
 	float ucolor[4];
 	
-	bool quadIndexesInitialized = false;
-	GLushort quadIndexes[ MAX_VERTS * 3 / 2 ];
+	// non-indexed quads are drawn as triangles through this index buffer,
+	// in chunks of QUAD_INDEX_VERTS vertices so 16 bit indexes suffice
+#define QUAD_INDEX_VERTS 65536
+	IndexBuffer *quadIndexBuffer;
 
 	int stride;
 	int offsets[ R3_NUM_VARYINGS ];
@@ -108,14 +117,126 @@ namespace {
 		
 	int attrib_sizes[] = { 12, 4, 12, 8, 8 };
 	
+	// Immediate mode batches are appended to a streaming ring buffer that
+	// is orphaned when it wraps, so an upload never waits on a pending draw.
 	VertexBuffer *imvb;
+	
+	// -1 means the GL value is unknown, so the next request is always issued
+	struct GlStateShadow {
+		struct Cap {
+			GLenum cap;
+			int unit;
+			bool enabled;
+		};
+		vector< Cap > caps;
+		int activeTexture;
+		int clientActiveTexture;
+		int arrayBuffer;
+		int elementBuffer;
+		int clientArrays[ R3_NUM_VARYINGS ];
+		int pointerBuffer[ R3_NUM_VARYINGS ];
+		int pointerStride[ R3_NUM_VARYINGS ];
+		int pointerOffset[ R3_NUM_VARYINGS ];
+		int blendSrc;
+		int blendDst;
+		
+		GlStateShadow() {
+			Invalidate();
+		}
+		void Invalidate() {
+			caps.clear();
+			activeTexture = clientActiveTexture = -1;
+			arrayBuffer = elementBuffer = -1;
+			for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+				clientArrays[ i ] = -1;
+				pointerBuffer[ i ] = -1;
+			}
+			blendSrc = blendDst = -1;
+		}
+	};
+	GlStateShadow shadow;
+	
+	bool Redundant( bool redundant ) {
+		if ( redundant ) {
+			r_glStateSkipped.SetVal( r_glStateSkipped.GetVal() + 1 );
+		} else {
+			r_glStateIssued.SetVal( r_glStateIssued.GetVal() + 1 );
+		}
+		return redundant;
+	}
+	
+	int ArrayIndex( VaryingEnum array ) {
+		for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+			if ( array == ( 1 << i ) ) {
+				return i;
+			}
+		}
+		assert( 0 );
+		return 0;
+	}
+	
+	GLenum ClientArrayCap[] = {
+		GL_VERTEX_ARRAY,
+		GL_COLOR_ARRAY,
+		GL_NORMAL_ARRAY,
+		GL_TEXTURE_COORD_ARRAY,
+		GL_TEXTURE_COORD_ARRAY
+	};
+	
+	void SetUniformColor() {
+		if ( Recording() ) {
+			Record( RecordOp_Color );
+			return;
+		}
+		glColor4f( ucolor[0], ucolor[1], ucolor[2], ucolor[3] );
+	}
+	
+	// verts is the number of vertices (or indices) the draw call consumes
+	void CountDraw( PrimitiveEnum prim, int verts ) {
+		int prims = 0;
+		switch ( prim ) {
+			case Primitive_Triangles: prims = verts / 3; break;
+			case Primitive_Quads: prims = verts / 4; break;
+			case Primitive_TriangleStrip:
+			case Primitive_TriangleFan: prims = max( 0, verts - 2 ); break;
+			case Primitive_Lines: prims = verts / 2; break;
+			case Primitive_LineStrip: prims = max( 0, verts - 1 ); break;
+			case Primitive_Points: prims = verts; break;
+			default: break;
+		}
+		CountRenderStat( RenderStat_Draws );
+		CountRenderStat( RenderStat_Verts, verts );
+		CountRenderStat( RenderStat_Primitives, prims );
+	}
+	
+	bool redrawRequested = true;
+	
+#define IM_RING_SIZE ( MAX_VERTS * sizeof( vab ) )
+	int imRingOffset = 0;
+	
+	void InitQuadIndexes() {
+		vector< GLushort > quadIndexes( QUAD_INDEX_VERTS * 3 / 2 );
+		for ( int i = 0; i < QUAD_INDEX_VERTS / 4; i++ )  {
+			quadIndexes[ i * 6 + 0 ] = i * 4 + 0;  // first triangle
+			quadIndexes[ i * 6 + 1 ] = i * 4 + 1;
+			quadIndexes[ i * 6 + 2 ] = i * 4 + 2;			
+			quadIndexes[ i * 6 + 3 ] = i * 4 + 0;  // second triangle
+			quadIndexes[ i * 6 + 4 ] = i * 4 + 2;
+			quadIndexes[ i * 6 + 5 ] = i * 4 + 3;
+		}
+		quadIndexBuffer = new IndexBuffer( "quadIndexes" );
+		quadIndexBuffer->SetData( (int)quadIndexes.size() * sizeof( GLushort ), & quadIndexes[0] );
+	}
 }
 
 namespace r3 {
+	void InvalidateTextureBindings();
 	
 	void InitDraw() {
 		ucolor[0] = ucolor[1] = ucolor[2] = ucolor[3] = 1.0f;
 		imvb = new VertexBuffer( "IMVB" );
+		imvb->SetData( IM_RING_SIZE, NULL, BufferUsage_Stream );
+		InitQuadIndexes();
 	}
 
 	// Vertex size in bytes based on its varying elements
@@ -136,6 +257,16 @@ namespace r3 {
 		stride = off;
 	}
 	
+	void RequestRedraw() {
+		redrawRequested = true;
+	}
+	
+	bool RedrawRequested() {
+		bool r = redrawRequested;
+		redrawRequested = false;
+		return r;
+	}
+	
 	// Immediate mode wrapper
 	void ImVarying( int varying ) {
 		currentVarying = varying | Varying_PositionBit; // position is compulsory in immediate mode
@@ -150,7 +281,7 @@ namespace r3 {
 	void ImBegin( PrimitiveEnum prim ) {
 		imPrim = prim;
 		if ( ( currentVarying & Varying_ColorBit ) == 0 ) {
-			glColor4f( ucolor[0], ucolor[1], ucolor[2], ucolor[3] );
+			SetUniformColor();
 		}
 		currentPrim = ToPrim[ int( prim ) ] ;
 		currentIndex = 0;
@@ -160,31 +291,26 @@ namespace r3 {
 		if ( imPrim == Primitive_Invalid || currentIndex == 0 ) {
 			return;
 		}
-		
-		if ( quadIndexesInitialized == false ) {
-			for ( int i = 0; i < MAX_VERTS / 4; i++ )  {
-				quadIndexes[ i * 6 + 0 ] = i * 4 + 0;  // first triangle
-				quadIndexes[ i * 6 + 1 ] = i * 4 + 1;
-				quadIndexes[ i * 6 + 2 ] = i * 4 + 2;			
-				quadIndexes[ i * 6 + 3 ] = i * 4 + 0;  // second triangle
-				quadIndexes[ i * 6 + 4 ] = i * 4 + 2;
-				quadIndexes[ i * 6 + 5 ] = i * 4 + 3;
-			}
-			quadIndexesInitialized = true;
+		int bytes = currentIndex * stride;
+		int offset = ( ( imRingOffset + stride - 1 ) / stride ) * stride;
+		if ( offset + bytes > (int)IM_RING_SIZE ) {
+			imvb->SetData( IM_RING_SIZE, NULL, BufferUsage_Stream );
+			offset = 0;
 		}
-		imvb->SetData( currentIndex * stride, verts );
 		imvb->SetVarying( currentVarying );
+		imvb->SetSubdata( offset, bytes, verts );
+		imvb->SetRange( offset, currentIndex );
+		imRingOffset = offset + bytes;
 		static vector< VertexBuffer *> vvb;
 		if ( vvb.size() != 1 ) {
 			vvb.push_back( NULL );
 		}
 		vvb[0] = imvb;
+		CountRenderStat( RenderStat_ImmediateDraws );
 		Draw( imPrim, vvb );
 		imPrim = Primitive_Invalid;
 		currentPrim = 0;
 		currentIndex = 0;
-
-		imvb->Disable();		
 	}
 	
 	void ImVertex( float x, float y, float z ) {
@@ -248,91 +374,348 @@ namespace r3 {
 	}
 	
 	
+	void StateEnable( unsigned int cap, bool enable, bool perTextureUnit ) {
+		int unit = perTextureUnit ? shadow.activeTexture : 0;
+		GlStateShadow::Cap *c = NULL;
+		for ( int i = 0; i < (int)shadow.caps.size(); i++ ) {
+			if ( shadow.caps[i].cap == cap && shadow.caps[i].unit == unit ) {
+				c = & shadow.caps[i];
+				break;
+			}
+		}
+		if ( unit >= 0 && Redundant( c != NULL && c->enabled == enable ) ) {
+			return;
+		}
+		if ( Recording() ) {
+			Record( enable ? RecordOp_Enable : RecordOp_Disable, cap, unit );
+		} else if ( enable ) {
+			glEnable( cap );
+		} else {
+			glDisable( cap );
+		}
+		if ( unit < 0 ) {
+			return; // unknown texture unit, so nothing to remember
+		}
+		if ( c == NULL ) {
+			GlStateShadow::Cap nc;
+			nc.cap = cap;
+			nc.unit = unit;
+			shadow.caps.push_back( nc );
+			c = & shadow.caps.back();
+		}
+		c->enabled = enable;
+	}
+	
+	void StateActiveTexture( int unit ) {
+		if ( Redundant( shadow.activeTexture == unit ) ) {
+			return;
+		}
+		if ( Recording() ) {
+			Record( RecordOp_ActiveTexture, GL_TEXTURE0 + unit );
+		} else {
+			glActiveTexture( GL_TEXTURE0 + unit );
+		}
+		shadow.activeTexture = unit;
+	}
+	
+	void StateClientActiveTexture( int unit ) {
+		if ( Redundant( shadow.clientActiveTexture == unit ) ) {
+			return;
+		}
+		if ( Recording() ) {
+			Record( RecordOp_ClientActiveTexture, GL_TEXTURE0 + unit );
+		} else {
+			glClientActiveTexture( GL_TEXTURE0 + unit );
+		}
+		shadow.clientActiveTexture = unit;
+	}
+	
+	void StateBindBuffer( unsigned int target, unsigned int obj ) {
+		int & bound = target == GL_ELEMENT_ARRAY_BUFFER ? shadow.elementBuffer : shadow.arrayBuffer;
+		if ( Redundant( bound == int( obj ) ) ) {
+			return;
+		}
+		if ( Recording() ) {
+			Record( RecordOp_BindBuffer, target, obj );
+		} else {
+			glBindBuffer( target, obj );
+		}
+		bound = obj;
+	}
+	
+	void StateDeleteBuffer( unsigned int obj ) {
+		// deleting a bound buffer reverts the binding to 0
+		if ( shadow.arrayBuffer == int( obj ) ) {
+			shadow.arrayBuffer = 0;
+		}
+		if ( shadow.elementBuffer == int( obj ) ) {
+			shadow.elementBuffer = 0;
+		}
+		for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+			if ( shadow.pointerBuffer[ i ] == int( obj ) ) {
+				shadow.pointerBuffer[ i ] = -1;
+			}
+		}
+	}
+	
+	void StateClientArray( VaryingEnum array, bool enable ) {
+		int i = ArrayIndex( array );
+		if ( Redundant( shadow.clientArrays[ i ] == int( enable ) ) ) {
+			return;
+		}
+		if ( array == Varying_TexCoord0Bit || array == Varying_TexCoord1Bit ) {
+			StateClientActiveTexture( array == Varying_TexCoord0Bit ? 0 : 1 );
+		}
+		if ( Recording() ) {
+			Record( RecordOp_ClientArray, ClientArrayCap[ i ], enable );
+		} else if ( enable ) {
+			glEnableClientState( ClientArrayCap[ i ] );
+		} else {
+			glDisableClientState( ClientArrayCap[ i ] );
+		}
+		shadow.clientArrays[ i ] = enable;
+	}
+	
+	bool StateArrayPointer( VaryingEnum array, int stride, int offset ) {
+		int i = ArrayIndex( array );
+		if ( Redundant( shadow.pointerBuffer[ i ] == shadow.arrayBuffer && shadow.arrayBuffer >= 0 &&
+					    shadow.pointerStride[ i ] == stride && shadow.pointerOffset[ i ] == offset ) ) {
+			return false;
+		}
+		shadow.pointerBuffer[ i ] = shadow.arrayBuffer;
+		shadow.pointerStride[ i ] = stride;
+		shadow.pointerOffset[ i ] = offset;
+		return true;
+	}
+	
+	void StateInvalidate() {
+		shadow.Invalidate();
+		InvalidateTextureBindings();
+	}
+	
 	void BlendFunc( BlendFuncEnum srcFactor, BlendFuncEnum dstFactor ) {
-		glBlendFunc( ToBlendFunc[ srcFactor ], ToBlendFunc[ dstFactor ] );
+		if ( Redundant( shadow.blendSrc == srcFactor && shadow.blendDst == dstFactor ) ) {
+			return;
+		}
+		if ( Recording() ) {
+			Record( RecordOp_BlendFunc, ToBlendFunc[ srcFactor ], ToBlendFunc[ dstFactor ] );
+		} else {
+			glBlendFunc( ToBlendFunc[ srcFactor ], ToBlendFunc[ dstFactor ] );
+		}
+		shadow.blendSrc = srcFactor;
+		shadow.blendDst = dstFactor;
 	}
 	
 	void BlendEnable() {
-		glEnable( GL_BLEND );
+		StateEnable( GL_BLEND, true );
 	}
 	
 	void BlendDisable() {
-		glDisable( GL_BLEND );
+		StateEnable( GL_BLEND, false );
 	}
 	
 	void DepthFunc( CompareEnum compare ) {
+		if ( Recording() ) {
+			Record( RecordOp_DepthFunc, compare + GL_NEVER );
+			return;
+		}
 		glDepthFunc( compare + GL_NEVER );
 	}
 	
 	void DepthTestEnable() {
-		glEnable( GL_DEPTH_TEST );
+		StateEnable( GL_DEPTH_TEST, true );
 	}
 	
 	void DepthTestDisable() {
-		glDisable( GL_DEPTH_TEST );
+		StateEnable( GL_DEPTH_TEST, false );
 	}
 
 	void AlphaFunc( CompareEnum compare, float ref ) {
+		if ( Recording() ) {
+			Record( RecordOp_AlphaFunc, compare + GL_NEVER );
+			return;
+		}
 		glAlphaFunc( compare + GL_NEVER, ref );
 	}
 
 	void AlphaTestEnable() {
-		glEnable( GL_ALPHA_TEST );
+		StateEnable( GL_ALPHA_TEST, true );
 	}
 
 	void AlphaTestDisable() {
-		glDisable( GL_ALPHA_TEST );
+		StateEnable( GL_ALPHA_TEST, false );
 	}
 
 
 
 	void LineWidth( float width ) {
+		if ( Recording() ) {
+			Record( RecordOp_LineWidth );
+			return;
+		}
 		glLineWidth( width );
 	}
 	
 	void PointSize( float size ) {
+		if ( Recording() ) {
+			Record( RecordOp_PointSize );
+			return;
+		}
 		glPointSize( size );
 	}
 
 	void PointSmoothEnable() {
-		glEnable( GL_POINT_SMOOTH );
+		StateEnable( GL_POINT_SMOOTH, true );
 	}
 
 	void PointSmoothDisable() {
-		glDisable( GL_POINT_SMOOTH );
+		StateEnable( GL_POINT_SMOOTH, false );
+	}
+
+	void PointSpriteEnable() {
+		static bool coordReplace = false;
+		if ( coordReplace == false ) {
+			StateActiveTexture( 0 );
+			if ( Recording() ) {
+				Record( RecordOp_TexEnv, GL_POINT_SPRITE, GL_COORD_REPLACE );
+			} else {
+				glTexEnvi( GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE );
+			}
+			coordReplace = true;
+		}
+		StateEnable( GL_POINT_SPRITE, true );
+	}
+
+	void PointSpriteDisable() {
+		StateEnable( GL_POINT_SPRITE, false );
 	}
 
 	
 	void Draw( PrimitiveEnum prim, const vector<VertexBuffer *> & vertexBuffers, const IndexBuffer * indexBuffer ) {
 		assert( vertexBuffers.size() );
 		uint varying = 0;
+		for ( int i = 0; i < (int)vertexBuffers.size(); i++ ) {
+			varying |= vertexBuffers[i]->GetVarying();
+		}
+		// arrays stay enabled between draws, so only turn off the unused ones
+		for ( int i = 0; i < R3_NUM_VARYINGS; i++ ) {
+			if ( ( varying & ( 1 << i ) ) == 0 ) {
+				StateClientArray( VaryingEnum( 1 << i ), false );
+			}
+		}
 		for ( int i = 0; i < (int)vertexBuffers.size(); i++ ) {
 			VertexBuffer *vb = vertexBuffers[i];
 			vb->Bind();
 			vb->Enable();
-			varying |= vb->GetVarying();
 		}
 		if ( ( varying & Varying_ColorBit ) == 0 ) {
-			glColor4f( ucolor[0], ucolor[1], ucolor[2], ucolor[3] );
+			SetUniformColor();
 		}
 		
 		if ( indexBuffer ) {
-			glPointSize( 9 );
+			PointSize( 9 );
 			indexBuffer->Bind();
-			glDrawElements( ToPrim[ prim ], indexBuffer->GetSize() / 2, GL_UNSIGNED_SHORT, (void *)0 );
+			CountDraw( prim, indexBuffer->GetSize() / 2 );
+			if ( Recording() ) {
+				Record( RecordOp_DrawElements, ToPrim[ prim ], 0, indexBuffer->GetSize() / 2 );
+			} else {
+				glDrawElements( ToPrim[ prim ], indexBuffer->GetSize() / 2, GL_UNSIGNED_SHORT, (void *)0 );
+			}
 			indexBuffer->Unbind();			
 		} else {
 			int indexes = vertexBuffers[0]->GetNumVerts();
 			if ( prim == Primitive_Quads ) { // support non-indexed quads
-				glDrawElements( GL_TRIANGLES, indexes * 3 / 2, GL_UNSIGNED_SHORT, quadIndexes );
+				quadIndexBuffer->Bind();
+				for ( int first = 0; first < indexes; first += QUAD_INDEX_VERTS ) {
+					if ( first > 0 ) {
+						// rebase the arrays for the next chunk
+						for ( int i = 0; i < (int)vertexBuffers.size(); i++ ) {
+							vertexBuffers[i]->Bind();
+							vertexBuffers[i]->Enable( first );
+						}
+					}
+					int count = min( indexes - first, QUAD_INDEX_VERTS );
+					CountDraw( Primitive_Quads, count );
+					if ( Recording() ) {
+						Record( RecordOp_DrawElements, GL_TRIANGLES, 0, count * 3 / 2 );
+					} else {
+						glDrawElements( GL_TRIANGLES, count * 3 / 2, GL_UNSIGNED_SHORT, (void *)0 );
+					}
+				}
+				quadIndexBuffer->Unbind();
 			} else {	
-				glDrawArrays( ToPrim[ prim ], 0, indexes );
+				CountDraw( prim, indexes );
+				if ( Recording() ) {
+					Record( RecordOp_DrawArrays, ToPrim[ prim ], 0, indexes );
+				} else {
+					glDrawArrays( ToPrim[ prim ], 0, indexes );
+				}
 			}
 		}
-		for ( int i = 0; i < (int)vertexBuffers.size(); i++ ) {
-			vertexBuffers[i]->Disable();
-			vertexBuffers[i]->Unbind();
+	}
+	
+	void MatrixPush() {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glPushMatrix();
+	}
+	
+	void MatrixPop() {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glPopMatrix();
+	}
+	
+	void MatrixLoadIdentity() {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glLoadIdentity();
+	}
+	
+	void MatrixLoad( const Matrix4f & m ) {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glLoadMatrixf( m.Ptr() );
+	}
+	
+	void MatrixMult( const Matrix4f & m ) {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glMultMatrixf( m.Ptr() );
+	}
+	
+	void MatrixTranslate( float x, float y, float z ) {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glTranslatef( x, y, z );
+	}
+	
+	void MatrixScale( float x, float y, float z ) {
+		if ( Recording() ) {
+			Record( RecordOp_Matrix );
+			return;
+		}
+		glScalef( x, y, z );
+	}
+	
+	void ClearFramebuffer() {
+		if ( Recording() ) {
+			Record( RecordOp_Clear, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+			return;
 		}
+		glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 	}
 	
 	void DrawQuad( float x0, float y0, float x1, float y1 ) {
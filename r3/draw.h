@@ -53,6 +53,12 @@ namespace r3 {
 	
 	void InitDraw();
 	
+	// Apps may skip frames when their own view state has not changed.
+	// Changes they cannot see, like input and console output, ask for the
+	// next frame to be drawn.  RedrawRequested() returns and clears the flag.
+	void RequestRedraw();
+	bool RedrawRequested();
+	
 #define R3_NUM_VARYINGS 5
 	
 	enum VaryingEnum {
@@ -140,8 +146,35 @@ namespace r3 {
 	void PointSize( float size );
 	void PointSmoothEnable();
 	void PointSmoothDisable();
+	// textured points, texture unit 0 gets coordinates across the point
+	void PointSpriteEnable();
+	void PointSpriteDisable();
 		
 	void Draw( PrimitiveEnum prim, const std::vector< VertexBuffer * > & vertexBuffers, const IndexBuffer * indexBuffer = NULL );
+	
+	// Shadowed GL state.  Requests that match the current state never reach
+	// GL, r_glStateIssued and r_glStateSkipped count the two cases.
+	void StateEnable( unsigned int cap, bool enable, bool perTextureUnit = false );
+	void StateActiveTexture( int unit );
+	void StateClientActiveTexture( int unit );
+	void StateBindBuffer( unsigned int target, unsigned int obj );
+	void StateDeleteBuffer( unsigned int obj );
+	void StateClientArray( VaryingEnum array, bool enable );
+	// returns false if the pointer for array is already current
+	bool StateArrayPointer( VaryingEnum array, int stride, int offset );
+	// forget everything, for use after GL calls made outside of r3
+	void StateInvalidate();
+
+	// Fixed function matrix stack and framebuffer clear, these go through
+	// the render backend like everything else in r3.
+	void MatrixPush();
+	void MatrixPop();
+	void MatrixLoadIdentity();
+	void MatrixLoad( const Matrix4f & m );
+	void MatrixMult( const Matrix4f & m );
+	void MatrixTranslate( float x, float y, float z );
+	void MatrixScale( float x, float y, float z );
+	void ClearFramebuffer();
 
 	void DrawQuad( float x0, float y0, float x1, float y1 );
 	void DrawTexturedQuad( float x0, float y0, float x1, float y1, float s0, float t0, float s1, float t1 );
@@ -53,6 +53,12 @@
 # include <sys/stat.h>
 #endif
 
+#if __linux__
+# include <unistd.h>
+# include <dirent.h>
+# include <sys/stat.h>
+#endif
+
 #if _WIN32
 # include <Windows.h>
 #endif
@@ -46,15 +46,21 @@
 #include "r3/draw.h"
 #include "r3/filesystem.h"
 #include "r3/font.h"
+#include "r3/gl.h"
+#include "r3/memtrack.h"
 #include "r3/output.h"
 #include "r3/texture.h"
+#include "r3/var.h"
 
+#include <list>
 #include <map>
 #include <string>
 
 using namespace std;
 using namespace r3;
 
+VarInteger r_textMeshCacheSize( "r_textMeshCacheSize", "number of text meshes kept in the label cache", 0, 256 );
+
 #define STB_TRUETYPE_IMPLEMENTATION  // force following include to generate implementation
 #include "stb_truetype.h"
 
@@ -104,10 +110,72 @@ namespace {
 		*xpos += b->xadvance * scale;
 	}
 	
+	// Glyph quads for one string, built once into a vertex buffer.  Meshes
+	// are laid out with the pen at the origin and positioned at draw time.
+	struct TextMesh {
+		VertexBuffer *vb;
+		int numVerts;
+	};
+	
+	struct TextMeshKey {
+		const Font *font;
+		string text;
+		float scale;
+		bool operator < ( const TextMeshKey & rhs ) const {
+			if ( font != rhs.font ) {
+				return font < rhs.font;
+			}
+			if ( scale != rhs.scale ) {
+				return scale < rhs.scale;
+			}
+			return text < rhs.text;
+		}
+	};
+	
+	// Least recently used meshes are at the back of the list, and their
+	// vertex buffers are recycled for new strings once the cache is full.
+	struct TextMeshCache {
+		typedef list< pair< TextMeshKey, TextMesh > > LruList;
+		LruList lru;
+		map< TextMeshKey, LruList::iterator > meshes;
+		int created;
+		
+		TextMeshCache() : created( 0 ) {}
+		
+		TextMesh * Find( const TextMeshKey & key ) {
+			map< TextMeshKey, LruList::iterator >::iterator it = meshes.find( key );
+			if ( it == meshes.end() ) {
+				return NULL;
+			}
+			lru.splice( lru.begin(), lru, it->second );
+			return & it->second->second;
+		}
+		
+		TextMesh * Insert( const TextMeshKey & key ) {
+			TextMesh tm;
+			if ( (int)lru.size() >= max( 1, r_textMeshCacheSize.GetVal() ) ) {
+				tm = lru.back().second;
+				meshes.erase( lru.back().first );
+				lru.pop_back();
+			} else {
+				char name[32];
+				r3Sprintf( name, "textMesh_%d", created++ );
+				tm.vb = new VertexBuffer( name );
+				tm.vb->SetVarying( Varying_PositionBit | Varying_TexCoord0Bit );
+			}
+			tm.numVerts = 0;
+			lru.push_front( make_pair( key, tm ) );
+			meshes[ key ] = lru.begin();
+			return & lru.front().second;
+		}
+	};
+	TextMeshCache *textMeshCache;
+	
 	struct StbFont : public Font {
 		StbFont( const string & texName, const string & ttfFilename, int imageSize );
 		virtual void Print( const std::string &text, float x, float y, float scale = 1.0f );	
 		virtual Bounds2f GetStringDimensions( const std::string &text, float scale = 1.0f );
+		void BuildTextMesh( const std::string &text, float scale, TextMesh *tm );
 		stbtt_bakedchar cdata[96]; // ASCII 32..126 is 95 glyphs
 		int imgSize;
 		Texture2D *ftex;
@@ -135,6 +203,8 @@ namespace {
 		//glGenerateMipmapOES( GL_TEXTURE_2D );
 		delete [] ttf_buffer;
 		delete [] temp_bitmap;		
+		// the atlas itself is counted with the textures
+		MemoryTrack( MemoryCategory_Font, texName, sizeof( cdata ) );
 	}
 	
 	
@@ -143,30 +213,59 @@ namespace {
 		if ( ftex == 0 ) {
 			return;
 		}
+		TextMeshKey key;
+		key.font = this;
+		key.text = text;
+		key.scale = scale;
+		TextMesh *tm = textMeshCache->Find( key );
+		if ( tm == NULL ) {
+			tm = textMeshCache->Insert( key );
+			BuildTextMesh( text, scale, tm );
+		}
+		if ( tm->numVerts == 0 ) {
+			return;
+		}
+		
 		// assume orthographic projection with units = screen pixels, origin at top left
 		ftex->Bind( 0 );
 		ftex->Enable();
-		
-		ImVarying( Varying_TexCoord0Bit );
-		//ImColor( 255, 192, 128, 255 );
-		ImBegin( Primitive_Quads );
+		MatrixPush();
+		MatrixTranslate( x, y, 0 );
+		static vector< VertexBuffer * > vvb( 1 );
+		vvb[0] = tm->vb;
+		Draw( Primitive_Quads, vvb );
+		MatrixPop();
+		ftex->Disable();
+	}
+	
+	void StbFont::BuildTextMesh( const string &text, float scale, TextMesh *tm ) {
+		vector< float > data;
+		data.reserve( text.size() * 4 * 5 );
+		float x = 0;
 		for ( int i = 0; i < (int)text.size(); i++ ) {
 			char c = text[i];
 			if ( c >= 32 ) {
 				stbtt_aligned_quad q;
-				//stbtt_GetBakedQuad(cdata, 512,512, *text-32, &x,&bakeY,&q,0); //1=opengl,0=old d3d
 				GetBakedScaledQuad( cdata, imgSize, imgSize, c-32, &x, 0, scale, &q ); 
-				DrawTexturedQuad( q.x0, y - q.y0, q.x1, y - q.y1, q.s0, q.t0, q.s1, q.t1 );
-				/*
-				ImTexCoord( 0, q.s0, q.t0 );			ImVertex( q.x0, y - q.y0 );
-				ImTexCoord( 0, q.s1, q.t0 );			ImVertex( q.x1, y - q.y0 );
-				ImTexCoord( 0, q.s1, q.t1 );			ImVertex( q.x1, y - q.y1 );
-				ImTexCoord( 0, q.s0, q.t1 );			ImVertex( q.x0, y - q.y1 );
-				 */
+				float v[4][4] = {
+					{ q.x0, -q.y0, q.s0, q.t0 },
+					{ q.x1, -q.y0, q.s1, q.t0 },
+					{ q.x1, -q.y1, q.s1, q.t1 },
+					{ q.x0, -q.y1, q.s0, q.t1 }
+				};
+				for ( int j = 0; j < 4; j++ ) {
+					data.push_back( v[j][0] );
+					data.push_back( v[j][1] );
+					data.push_back( 0.0f );
+					data.push_back( v[j][2] );
+					data.push_back( v[j][3] );
+				}
 			}
 		}
-		ImEnd();
-		ftex->Disable();
+		tm->numVerts = (int)data.size() / 5;
+		if ( tm->numVerts > 0 ) {
+			tm->vb->SetData( (int)data.size() * sizeof( float ), & data[0] );
+		}
 	}
 	
 	Bounds2f StbFont::GetStringDimensions( const std::string & text, float scale ) {
@@ -198,6 +297,7 @@ namespace r3 {
 			return;
 		}
 		fontDatabase = new FontDatabase();
+		textMeshCache = new TextMeshCache();
 		initialized = true;
 		
 	}
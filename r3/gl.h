@@ -58,12 +58,22 @@
 #  define GL_TEXTURE_MIN_LOD 0
 #  define GL_TEXTURE_MAX_LOD 0
 #  define GL_DEPTH_COMPONENT GL_DEPTH_COMPONENT16_OES
+#  define GL_STREAM_DRAW GL_DYNAMIC_DRAW
+#  define GL_POINT_SPRITE GL_POINT_SPRITE_OES
+#  define GL_COORD_REPLACE GL_COORD_REPLACE_OES
 #  define glGenerateMipmapEXT glGenerateMipmapOES
 #  define GlInternalFormat GlFormat
 
 #  define GL_FRAMEBUFFER_EXT GL_FRAMEBUFFER_OES
 #  define GL_RENDERBUFFER_EXT GL_RENDERBUFFER_OES
 #  define GL_COLOR_ATTACHMENT0_EXT GL_COLOR_ATTACHMENT0_OES
+#  define GL_FRAMEBUFFER_BINDING_EXT GL_FRAMEBUFFER_BINDING_OES
+#  define GL_FRAMEBUFFER_COMPLETE_EXT GL_FRAMEBUFFER_COMPLETE_OES
+#  define glGenFramebuffersEXT glGenFramebuffersOES
+#  define glDeleteFramebuffersEXT glDeleteFramebuffersOES
+#  define glBindFramebufferEXT glBindFramebufferOES
+#  define glFramebufferTexture2DEXT glFramebufferTexture2DOES
+#  define glCheckFramebufferStatusEXT glCheckFramebufferStatusOES
 #  define glGenRenderbuffersEXT glGenRenderbuffersOES
 #  define glDeleteRenderbuffersEXT glDeleteRenderbuffersOES
 #  define glBindRenderbufferEXT glBindRenderbufferOES
@@ -83,5 +93,11 @@
 # include "r3/GL/entry.h"
 #endif
 
+#if __linux__
+# define GL_GLEXT_PROTOTYPES
+# include <GL/gl.h>
+# include <GL/glext.h>
+#endif
+
 
 #endif // __R3_GL_H__
@@ -47,6 +47,7 @@ Cass Everitt
 #include "r3/socket.h"
 
 #include <assert.h>
+#include <string.h>
 
 #include <deque>
 #include <vector>
@@ -45,7 +45,9 @@
 #include "r3/filesystem.h"
 
 
+#include <algorithm>
 #include <vector>
+#include <string.h>
 
 using namespace std;
 using namespace r3;
@@ -55,14 +57,54 @@ using namespace r3;
 
 namespace {
 	
+	unsigned int crcTable[ 256 ];
+	
+	unsigned int Crc( unsigned int crc, const unsigned char *data, int size ) {
+		if ( crcTable[ 1 ] == 0 ) {
+			for ( unsigned int n = 0; n < 256; n++ ) {
+				unsigned int c = n;
+				for ( int k = 0; k < 8; k++ ) {
+					c = ( c & 1 ) ? 0xedb88320 ^ ( c >> 1 ) : c >> 1;
+				}
+				crcTable[ n ] = c;
+			}
+		}
+		crc = ~crc;
+		for ( int i = 0; i < size; i++ ) {
+			crc = crcTable[ ( crc ^ data[i] ) & 0xff ] ^ ( crc >> 8 );
+		}
+		return ~crc;
+	}
+	
+	void PutU32( vector< unsigned char > & v, unsigned int u ) {
+		v.push_back( u >> 24 );
+		v.push_back( u >> 16 );
+		v.push_back( u >> 8 );
+		v.push_back( u );
+	}
+	
+	void PutChunk( vector< unsigned char > & png, const char *type, const vector< unsigned char > & data ) {
+		PutU32( png, (unsigned int)data.size() );
+		int start = (int)png.size();
+		png.insert( png.end(), type, type + 4 );
+		png.insert( png.end(), data.begin(), data.end() );
+		PutU32( png, Crc( 0, & png[ start ], (int)png.size() - start ) );
+	}
+	
 	class StbImage : public Image<unsigned char> {
 		unsigned char *data;
 	public:
 		StbImage() : data( NULL ) {
+			width = height = components = 0;
 		}
 		StbImage( const string & filename, int desiredComponents ) : data( NULL ) {
+			width = height = components = 0;
 			Load( filename, desiredComponents );
 		}
+		StbImage( const vector< unsigned char > & fileData, int desiredComponents ) : data( NULL ) {
+			width = height = components = 0;
+			Decode( fileData, desiredComponents );
+		}
 		virtual ~StbImage() {
 			Free();
 		}
@@ -76,17 +118,24 @@ namespace {
 		void Load( const string & filename, int desiredComponents ) {
 			vector< unsigned char > v;
 			FileReadToMemory( filename, v );
-			int c = 0;
+			Decode( v, desiredComponents );
+		}
+		void Decode( const vector< unsigned char > & v, int desiredComponents ) {
+			unsigned char *d = NULL;
 			if ( v.size() > 0 ) {
-				unsigned char *d = stbi_load_from_memory(& v[0], v.size(), &width, &height, &components, desiredComponents);
-				c = max( desiredComponents, components );
-				data = new unsigned char[ width * height * c ];
-				int pitch = width * c;
-				for ( int j = 0; j < height; j++ ) {
-					memcpy( data + ( height - 1 - j ) * pitch, d + j * pitch, pitch );
-				}
-				stbi_image_free( d );
+				d = stbi_load_from_memory(& v[0], v.size(), &width, &height, &components, desiredComponents);
+			}
+			if ( d == NULL ) {
+				width = height = components = 0;
+				return;
+			}
+			int c = max( desiredComponents, components );
+			data = new unsigned char[ width * height * c ];
+			int pitch = width * c;
+			for ( int j = 0; j < height; j++ ) {
+				memcpy( data + ( height - 1 - j ) * pitch, d + j * pitch, pitch );
 			}
+			stbi_image_free( d );
 			// compute alpha as "is rgb effectively non-zero" if it doesn't exist in the input image
 			if ( desiredComponents == 4 && components == 3 ) {
 				unsigned char *uc = data;
@@ -120,7 +169,7 @@ namespace {
 				}
 			}
 			
-			components = desiredComponents;
+			components = c;
 		}
 	};
 	
@@ -132,4 +181,66 @@ namespace r3 {
 	Image<unsigned char> * LoadStbImage( const std::string & filename, int desiredComponents ) {
 		return new StbImage( filename, desiredComponents );
 	}
+	
+	Image<unsigned char> * LoadStbImage( const std::vector< unsigned char > & fileData, int desiredComponents ) {
+		return new StbImage( fileData, desiredComponents );
+	}
+	
+	bool WritePng( const std::string & filename, int width, int height, int components, const unsigned char *data ) {
+		static const unsigned char colorType[] = { 0, 0, 4, 2, 6 };
+		if ( components < 1 || components > 4 || width <= 0 || height <= 0 ) {
+			return false;
+		}
+		
+		// filter type 0 on every row, flipped to PNG's top down order
+		int pitch = width * components;
+		vector< unsigned char > raw;
+		raw.reserve( ( pitch + 1 ) * height );
+		for ( int j = height - 1; j >= 0; j-- ) {
+			raw.push_back( 0 );
+			raw.insert( raw.end(), data + j * pitch, data + ( j + 1 ) * pitch );
+		}
+		
+		vector< unsigned char > z;
+		z.push_back( 0x78 );
+		z.push_back( 0x01 );
+		unsigned int a = 1, b = 0;
+		for ( int i = 0; i < (int)raw.size(); i++ ) {
+			a = ( a + raw[i] ) % 65521;
+			b = ( b + a ) % 65521;
+		}
+		for ( int i = 0; i < (int)raw.size(); i += 65535 ) {
+			int n = min( 65535, (int)raw.size() - i );
+			z.push_back( i + n == (int)raw.size() ? 1 : 0 );
+			z.push_back( n & 0xff );
+			z.push_back( n >> 8 );
+			z.push_back( ~n & 0xff );
+			z.push_back( ( ~n >> 8 ) & 0xff );
+			z.insert( z.end(), raw.begin() + i, raw.begin() + i + n );
+		}
+		PutU32( z, ( b << 16 ) | a );
+		
+		vector< unsigned char > ihdr;
+		PutU32( ihdr, width );
+		PutU32( ihdr, height );
+		ihdr.push_back( 8 );
+		ihdr.push_back( colorType[ components ] );
+		ihdr.push_back( 0 );
+		ihdr.push_back( 0 );
+		ihdr.push_back( 0 );
+		
+		static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		vector< unsigned char > png( signature, signature + 8 );
+		PutChunk( png, "IHDR", ihdr );
+		PutChunk( png, "IDAT", z );
+		PutChunk( png, "IEND", vector< unsigned char >() );
+		
+		File *f = FileOpenForWrite( filename );
+		if ( f == NULL ) {
+			return false;
+		}
+		int written = f->Write( & png[0], 1, (int)png.size() );
+		delete f;
+		return written == (int)png.size();
+	}
 }
@@ -47,6 +47,7 @@
 #define __R3_IMAGE_H__
 
 #include <string>
+#include <vector>
 
 namespace r3 {
 	
@@ -77,6 +78,13 @@ namespace r3 {
 	};
 	
 	Image<unsigned char> * LoadStbImage( const std::string & filename, int desiredComponents = 0 );
+	// decodes a file already read into memory
+	Image<unsigned char> * LoadStbImage( const std::vector< unsigned char > & fileData, int desiredComponents = 0 );
+	
+	// Writes 8 bit L, LA, RGB or RGBA data, first row at the bottom as with
+	// loaded images, through FileOpenForWrite().  The zlib stream is made of
+	// stored blocks, so files are large but need no compressor.
+	bool WritePng( const std::string & filename, int width, int height, int components, const unsigned char *data );
 	
 }
 
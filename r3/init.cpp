@@ -49,7 +49,9 @@
 #include "r3/gl.h"
 #include "r3/model.h"
 #include "r3/output.h"
+#include "r3/record.h"
 #include "r3/texture.h"
+#include "r3/trace.h"
 #include "r3/var.h"
 
 using namespace std;
@@ -57,6 +59,7 @@ using namespace std;
 namespace r3 {
 	
 	void Init( int argc, char **argv ) {
+		InitOutput();
 		vector< string > commands;
 		string command;
 		vector< string > av;
@@ -78,6 +81,7 @@ namespace r3 {
 			ExecuteCommand( commands[ i ].c_str() );
 		}
 		Output( "end   Command Line directives ----------------" );
+		InitTrace();
 		InitFilesystem();
 		extern VarString f_basePath;
 		if ( f_basePath.GetVal().size() == 0 ) {
@@ -90,6 +94,7 @@ namespace r3 {
 #if _WIN32
 		InitGLEntry();
 #endif
+		InitRenderBackend();
 		InitBuffer();
 		InitDraw();
 		InitFont();
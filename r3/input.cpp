@@ -45,6 +45,7 @@
 #include "r3/input.h"
 #include "r3/command.h"
 #include "r3/common.h"
+#include "r3/draw.h"
 #include "r3/filesystem.h"
 #include "r3/output.h"
 
@@ -319,6 +320,7 @@ namespace r3 {
 	}
 	
 	void ProcessKeyEvent( int key, KeyStateEnum keyState ) {
+		RequestRedraw();
 		if ( keyEventHandler ) {
 			keyEventHandler( key, keyState );
 		} else {
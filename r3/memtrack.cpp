@@ -0,0 +1,200 @@
+/*
+ *  memtrack.cpp
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/memtrack.h"
+
+#include "r3/command.h"
+#include "r3/common.h"
+#include "r3/output.h"
+#include "r3/thread.h"
+#include "r3/var.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+using namespace r3;
+
+VarInteger r_memBudgetTextures( "r_memBudgetTextures", "texture memory budget in KB, 0 for none", Var_Archive, 0 );
+VarInteger r_memBudgetBuffers( "r_memBudgetBuffers", "buffer memory budget in KB, 0 for none", Var_Archive, 0 );
+VarInteger r_memBudgetImages( "r_memBudgetImages", "CPU image memory budget in KB, 0 for none", Var_Archive, 0 );
+VarInteger r_memBudgetFonts( "r_memBudgetFonts", "CPU font memory budget in KB, 0 for none", Var_Archive, 0 );
+VarInteger r_memBudgetCatalogs( "r_memBudgetCatalogs", "CPU catalog memory budget in KB, 0 for none", Var_Archive, 0 );
+
+namespace {
+	
+	const char *categoryNames[] = {
+		"textures",
+		"buffers",
+		"images",
+		"fonts",
+		"catalogs"
+	};
+	
+	const bool categoryIsGpu[] = {
+		true,
+		true,
+		false,
+		false,
+		false
+	};
+	
+	VarInteger *budgets[] = {
+		&r_memBudgetTextures,
+		&r_memBudgetBuffers,
+		&r_memBudgetImages,
+		&r_memBudgetFonts,
+		&r_memBudgetCatalogs
+	};
+	
+	struct Category {
+		Category() : total( 0 ), highWater( 0 ), overBudget( false ) {}
+		map< string, int > allocations;
+		int total;
+		int highWater;
+		bool overBudget;
+	};
+	
+	Mutex memMutex;
+	Category categories[ MemoryCategory_MAX ];
+	int poolHighWater[ 2 ];  // cpu, gpu
+	
+	float KB( int bytes ) {
+		return bytes / 1024.0f;
+	}
+	
+	struct Allocation {
+		int bytes;
+		MemoryCategoryEnum cat;
+		string name;
+		bool operator < ( const Allocation & rhs ) const {
+			return bytes > rhs.bytes;
+		}
+	};
+	
+	// memreport command
+	void MemReport( const vector< Token > & tokens ) {
+		int top = 20;
+		if ( tokens.size() > 1 && tokens[1].type == TokenType_Number ) {
+			top = int( tokens[1].valNumber );
+		}
+		vector< Allocation > allocs;
+		int pool[ 2 ] = { 0, 0 };
+		ScopedMutex m( memMutex );
+		Output( "%-10s %12s %12s %12s %6s", "category", "KB", "high KB", "budget KB", "count" );
+		for ( int i = 0; i < MemoryCategory_MAX; i++ ) {
+			Category & c = categories[ i ];
+			Output( "%-10s %12.1f %12.1f %12d %6d", categoryNames[ i ], KB( c.total ), KB( c.highWater ),
+				   budgets[ i ]->GetVal(), (int)c.allocations.size() );
+			pool[ categoryIsGpu[ i ] ] += c.total;
+			for ( map< string, int >::iterator it = c.allocations.begin(); it != c.allocations.end(); ++it ) {
+				Allocation a;
+				a.bytes = it->second;
+				a.cat = MemoryCategoryEnum( i );
+				a.name = it->first;
+				allocs.push_back( a );
+			}
+		}
+		Output( "%-10s %12.1f %12.1f", "gpu", KB( pool[ 1 ] ), KB( poolHighWater[ 1 ] ) );
+		Output( "%-10s %12.1f %12.1f", "cpu", KB( pool[ 0 ] ), KB( poolHighWater[ 0 ] ) );
+		sort( allocs.begin(), allocs.end() );
+		top = min( top, (int)allocs.size() );
+		if ( top > 0 ) {
+			Output( "largest %d:", top );
+		}
+		for ( int i = 0; i < top; i++ ) {
+			Output( "  %10.1f KB  %-10s %s", KB( allocs[ i ].bytes ), categoryNames[ allocs[ i ].cat ], allocs[ i ].name.c_str() );
+		}
+	}
+	CommandFunc MemReportCmd( "memreport", "memreport [count] - memory totals by category and the largest allocations", MemReport );
+	
+}
+
+namespace r3 {
+	
+	void MemoryTrack( MemoryCategoryEnum cat, const string & name, int bytes ) {
+		int total;
+		int budget = budgets[ cat ]->GetVal() * 1024;
+		bool warn = false;
+		{
+			ScopedMutex m( memMutex );
+			Category & c = categories[ cat ];
+			map< string, int >::iterator it = c.allocations.find( name );
+			if ( it != c.allocations.end() ) {
+				c.total -= it->second;
+				c.allocations.erase( it );
+			}
+			if ( bytes > 0 ) {
+				c.allocations[ name ] = bytes;
+				c.total += bytes;
+			}
+			c.highWater = max( c.highWater, c.total );
+			
+			int pool = 0;
+			for ( int i = 0; i < MemoryCategory_MAX; i++ ) {
+				if ( categoryIsGpu[ i ] == categoryIsGpu[ cat ] ) {
+					pool += categories[ i ].total;
+				}
+			}
+			int & high = poolHighWater[ categoryIsGpu[ cat ] ];
+			high = max( high, pool );
+			
+			// warn once per crossing, not on every allocation past it
+			bool over = budget > 0 && c.total > budget;
+			warn = over && c.overBudget == false;
+			c.overBudget = over;
+			total = c.total;
+		}
+		if ( warn ) {
+			Output( "Warning: %s use %.1f KB, over the %d KB budget (adding %s).",
+				   categoryNames[ cat ], KB( total ), budget / 1024, name.c_str() );
+		}
+	}
+	
+	int MemoryTotal( MemoryCategoryEnum cat ) {
+		ScopedMutex m( memMutex );
+		return categories[ cat ].total;
+	}
+	
+}
@@ -0,0 +1,71 @@
+/*
+ *  memtrack.h
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_MEMTRACK_H__
+#define __R3_MEMTRACK_H__
+
+#include <string>
+
+namespace r3 {
+	
+	// Byte accounting for the big allocations, by category and name.
+	// "memreport" prints the totals, high-water marks and the largest
+	// allocations, and each category can be given a budget in KB through
+	// its r_memBudget* var.
+	enum MemoryCategoryEnum {
+		MemoryCategory_Texture,   // GPU, including the generated mip chain
+		MemoryCategory_Buffer,    // GPU
+		MemoryCategory_Image,     // CPU copies of image data
+		MemoryCategory_Font,      // CPU glyph tables and atlases
+		MemoryCategory_Catalog,   // CPU star, name and sky catalogs
+		MemoryCategory_MAX
+	};
+	
+	// Sets the size of the named allocation, 0 forgets it.  Warns when
+	// this takes the category over its budget.  Safe from any thread.
+	void MemoryTrack( MemoryCategoryEnum cat, const std::string & name, int bytes );
+	int MemoryTotal( MemoryCategoryEnum cat );
+	
+}
+
+#endif // __R3_MEMTRACK_H__
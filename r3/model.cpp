@@ -66,11 +66,14 @@ namespace {
 			return;
 		}
 		map< string, Model * > &models = modelDatabase->models;
+		int total = 0;
 		for( map< string, Model * >::iterator it = models.begin(); it != models.end(); ++it ) {
 			const string & n = it->first;
-			//Model * m = it->second;
-			Output( "%s", n.c_str() );					
+			Model * m = it->second;
+			Output( "%s - sz=%d", n.c_str(), m->GetSize() );
+			total += m->GetSize();
 		}
+		Output( "%d models, %d KB", (int)models.size(), total >> 10 );
 	}
 	CommandFunc ListModelsCmd( "listmodels", "lists defined models", ListModels );
 	
@@ -92,7 +95,7 @@ namespace r3 {
 	, vertexBuffer( NULL )
 	, indexBuffer( NULL ) {
 		assert( modelDatabase->models.count( name ) == 0 );
-		modelDatabase->models[ name ];
+		modelDatabase->models[ name ] = this;
 	}
 
 	Model::~Model() {
@@ -101,6 +104,17 @@ namespace r3 {
 		delete indexBuffer;
 	}
 	
+	int Model::GetSize() const {
+		int sz = 0;
+		if ( vertexBuffer ) {
+			sz += vertexBuffer->GetSize();
+		}
+		if ( indexBuffer ) {
+			sz += indexBuffer->GetSize();
+		}
+		return sz;
+	}
+	
 	VertexBuffer & Model::GetVertexBuffer() {
 		if ( vertexBuffer == NULL ) {
 			vertexBuffer = new VertexBuffer( name + "_vb" );
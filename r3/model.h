@@ -69,6 +69,8 @@ namespace r3 {
 		const std::string GetName() const {
 			return name;
 		}
+		// bytes in the vertex and index buffers
+		int GetSize() const;
 		VertexBuffer & GetVertexBuffer();
 		IndexBuffer & GetIndexBuffer();
 		PrimitiveEnum GetPrimitive() const {
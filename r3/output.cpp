@@ -60,20 +60,57 @@ using namespace std;
 
 namespace {
 	Mutex outputMutex;
+	
+	bool captureReady;
+#if __APPLE__ || __linux__
+	pthread_key_t captureKey;
+#elif _WIN32
+	DWORD captureKey;
+#endif
+	
+	vector< string > * CapturedOutput() {
+		if ( captureReady == false ) {
+			return NULL;
+		}
+#if __APPLE__ || __linux__
+		return static_cast< vector< string > * >( pthread_getspecific( captureKey ) );
+#elif _WIN32
+		return static_cast< vector< string > * >( TlsGetValue( captureKey ) );
+#endif
+	}
 }
 
 namespace r3 {
 	
 	void InitOutput() {
+#if __APPLE__ || __linux__
+		pthread_key_create( &captureKey, NULL );
+#elif _WIN32
+		captureKey = TlsAlloc();
+#endif
+		captureReady = true;
+	}
+	
+	void CaptureOutput( vector< string > * lines ) {
+#if __APPLE__ || __linux__
+		pthread_setspecific( captureKey, lines );
+#elif _WIN32
+		TlsSetValue( captureKey, lines );
+#endif
 	}
 	
 	void Output( const char *fmt, ... ) {
-		ScopedMutex m( outputMutex );
 		char str[16384];
 		va_list args;
 		va_start( args, fmt );
 		r3Vsprintf( str, fmt, args );
 		va_end( args );
+		vector< string > * capture = CapturedOutput();
+		if ( capture ) {
+			capture->push_back( str );
+			return;
+		}
+		ScopedMutex m( outputMutex );
 		extern Console console;
 		console.AppendOutput( str );
 #if _WIN32
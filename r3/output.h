@@ -44,6 +44,9 @@
 #ifndef __R3_OUTPUT_H__
 #define __R3_OUTPUT_H__
 
+#include <string>
+#include <vector>
+
 namespace r3 {
 	
 	void InitOutput();
@@ -51,6 +54,11 @@ namespace r3 {
 	void Output( const char *fmt, ... );
 	void OutputDebug( const char *fmt, ... );
 	
+	// While lines is set, Output() on the calling thread appends to it
+	// instead of the console, so a worker can hand its messages to the
+	// main thread to print.  Pass NULL to stop.
+	void CaptureOutput( std::vector< std::string > * lines );
+	
 }
 
 #endif // __R3_OUTPUT_H__
\ No newline at end of file
@@ -0,0 +1,238 @@
+/*
+ *  profile.cpp
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/profile.h"
+
+#include "r3/command.h"
+#include "r3/common.h"
+#include "r3/draw.h"
+#include "r3/font.h"
+#include "r3/output.h"
+#include "r3/renderstats.h"
+#include "r3/trace.h"
+#include "r3/var.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace r3;
+
+extern VarInteger r_windowWidth;
+extern VarInteger r_windowHeight;
+extern VarString con_font;
+extern VarInteger con_fontSize;
+extern VarFloat con_fontScale;
+
+VarBool r_profile( "r_profile", "time the named frame stages, see listtimers", 0, false );
+VarBool r_profileOverlay( "r_profileOverlay", "draw the frame stage timers on screen when r_profile is set", 0, false );
+
+namespace {
+	
+	// built on first use, timers are constructed during static init
+	vector< ProfileTimer * > * timers;
+	
+	ProfileTimer frameTimer( "frame" );
+	double lastFrame;
+	
+	// listtimers command
+	void ListTimers( const vector< Token > & tokens ) {
+		if ( profileEnabled == false ) {
+			Output( "r_profile is 0, set it to 1 to collect timings." );
+		}
+		Output( "%-24s %6s %8s %8s %8s %8s", "timer (ms per frame)", "calls", "min", "avg", "max", "p99" );
+		for ( int i = 0; i < (int)timers->size(); i++ ) {
+			ProfileTimer *t = (*timers)[ i ];
+			if ( t->Samples() == 0 ) {
+				continue;
+			}
+			float mn, avg, mx, p99;
+			t->GetStats( mn, avg, mx, p99 );
+			Output( "%-24s %6.1f %8.3f %8.3f %8.3f %8.3f", t->Name(), t->CallsPerFrame(), mn, avg, mx, p99 );
+		}
+	}
+	CommandFunc ListTimersCmd( "listtimers", "lists the frame stage timers over the last frames", ListTimers );
+	
+	// cleartimers command
+	void ClearTimers( const vector< Token > & tokens ) {
+		for ( int i = 0; i < (int)timers->size(); i++ ) {
+			(*timers)[ i ]->Clear();
+		}
+	}
+	CommandFunc ClearTimersCmd( "cleartimers", "empties the frame stage timer windows", ClearTimers );
+	
+}
+
+namespace r3 {
+	
+	bool profileEnabled;
+	bool profileActive;
+	
+	ProfileTimer::ProfileTimer( const char * timerName ) : name( timerName ) {
+		Clear();
+		if ( timers == NULL ) {
+			timers = new vector< ProfileTimer * >;
+		}
+		timers->push_back( this );
+	}
+	
+	double ProfileTimer::Begin() {
+		double t = GetTime();
+		if ( Tracing() ) {
+			TraceBegin( name, t );
+		}
+		return t;
+	}
+	
+	void ProfileTimer::End( double start ) {
+		double t = GetTime();
+		if ( profileEnabled ) {
+			Add( t - start );
+		}
+		if ( Tracing() ) {
+			TraceEnd( name, t );
+		}
+	}
+	
+	void ProfileTimer::Clear() {
+		frameTime = 0.0;
+		frameCalls = 0;
+		count = next = 0;
+	}
+	
+	void ProfileTimer::EndFrame() {
+		history[ next ] = float( frameTime * 1000.0 );
+		calls[ next ] = frameCalls;
+		next = ( next + 1 ) % R3_PROFILE_WINDOW;
+		count = min( count + 1, R3_PROFILE_WINDOW );
+		frameTime = 0.0;
+		frameCalls = 0;
+	}
+	
+	void ProfileTimer::GetStats( float & minMs, float & avgMs, float & maxMs, float & p99Ms ) const {
+		minMs = avgMs = maxMs = p99Ms = 0.0f;
+		if ( count == 0 ) {
+			return;
+		}
+		float sorted[ R3_PROFILE_WINDOW ];
+		float sum = 0.0f;
+		for ( int i = 0; i < count; i++ ) {
+			sorted[ i ] = history[ i ];
+			sum += history[ i ];
+		}
+		sort( sorted, sorted + count );
+		minMs = sorted[ 0 ];
+		maxMs = sorted[ count - 1 ];
+		avgMs = sum / count;
+		p99Ms = sorted[ ( count * 99 ) / 100 ];
+	}
+	
+	float ProfileTimer::CallsPerFrame() const {
+		if ( count == 0 ) {
+			return 0.0f;
+		}
+		int sum = 0;
+		for ( int i = 0; i < count; i++ ) {
+			sum += calls[ i ];
+		}
+		return float( sum ) / count;
+	}
+	
+	void ProfileFrame() {
+		if ( profileEnabled ) {
+			// frame is the time from one ProfileFrame() to the next, so it
+			// includes whatever the platform does between frames
+			double now = GetTime();
+			if ( lastFrame != 0.0 ) {
+				frameTimer.Add( now - lastFrame );
+			}
+			lastFrame = now;
+			for ( int i = 0; i < (int)timers->size(); i++ ) {
+				(*timers)[ i ]->EndFrame();
+			}
+		}
+		if ( profileEnabled != r_profile.GetVal() ) {
+			profileEnabled = r_profile.GetVal();
+			lastFrame = 0.0;
+		}
+		TraceFrame();
+		RenderStatsFrame();
+		profileActive = profileEnabled || Tracing();
+	}
+	
+	void DrawProfileOverlay() {
+		if ( profileEnabled == false || r_profileOverlay.GetVal() == false ) {
+			return;
+		}
+		Font *font = CreateStbFont( con_font.GetVal(), con_fontSize.GetVal() );
+		if ( font == NULL ) {
+			return;
+		}
+		float s = con_fontScale.GetVal();
+		float yAdvance = font->GetStringDimensions( "|", s ).Height();
+		int border = 10;
+		int x0 = border;
+		int y = r_windowHeight.GetVal() - border - int( yAdvance );
+		
+		BlendFunc( BlendFunc_SrcAlpha, BlendFunc_OneMinusSrcAlpha );
+		BlendEnable();
+		ImColor( 255, 255, 128, 192 );
+		font->Print( "    avg     max     p99  ms", x0, y, s );
+		y -= yAdvance;
+		ImColor( 255, 255, 255, 192 );
+		char line[ 128 ];
+		for ( int i = 0; i < (int)timers->size() && y > 0; i++ ) {
+			ProfileTimer *t = (*timers)[ i ];
+			if ( t->Samples() == 0 ) {
+				continue;
+			}
+			float mn, avg, mx, p99;
+			t->GetStats( mn, avg, mx, p99 );
+			r3Sprintf( line, "%7.3f %7.3f %7.3f  %s", avg, mx, p99, t->Name() );
+			font->Print( line, x0, y, s );
+			y -= yAdvance;
+		}
+		BlendDisable();
+	}
+	
+}
@@ -0,0 +1,124 @@
+/*
+ *  profile.h
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_PROFILE_H__
+#define __R3_PROFILE_H__
+
+#include "r3/time.h"
+
+#define R3_PROFILE_WINDOW 128
+
+namespace r3 {
+	
+	// Named CPU timers for the stages of a frame.  A timer is a global
+	// that registers itself on construction, like a Var.  ProfileScope
+	// adds to the timer's total for the current frame and ProfileFrame()
+	// moves those totals into a rolling window of the last
+	// R3_PROFILE_WINDOW frames.  Timing is off unless r_profile is set,
+	// and then a scope costs one flag test.  Scopes also show up in trace
+	// captures, see trace.h.
+	class ProfileTimer {
+	public:
+		ProfileTimer( const char * timerName );
+		
+		const char * Name() const {
+			return name;
+		}
+		void Add( double seconds ) {
+			frameTime += seconds;
+			frameCalls++;
+		}
+		double Begin();
+		void End( double start );
+		void EndFrame();
+		void Clear();
+		
+		// statistics over the window, in milliseconds per frame
+		int Samples() const {
+			return count;
+		}
+		void GetStats( float & minMs, float & avgMs, float & maxMs, float & p99Ms ) const;
+		float CallsPerFrame() const;
+		
+	private:
+		const char * name;
+		double frameTime;
+		int frameCalls;
+		float history[ R3_PROFILE_WINDOW ];
+		int calls[ R3_PROFILE_WINDOW ];
+		int count;
+		int next;
+	};
+	
+	// r_profile as of the last ProfileFrame()
+	extern bool profileEnabled;
+	// timing or tracing
+	extern bool profileActive;
+	
+	class ProfileScope {
+	public:
+		ProfileScope( ProfileTimer & t ) : timer( profileActive ? &t : NULL ) {
+			if ( timer ) {
+				start = timer->Begin();
+			}
+		}
+		~ProfileScope() {
+			if ( timer ) {
+				timer->End( start );
+			}
+		}
+	private:
+		ProfileTimer * timer;
+		double start;
+	};
+	
+	// Call once at the end of each frame.  Also steps trace captures and
+	// publishes the render stats.
+	void ProfileFrame();
+	// Draws the timers in the top left corner when r_profileOverlay is
+	// set.  Expects the same ortho projection as the console.
+	void DrawProfileOverlay();
+	
+}
+
+#endif // __R3_PROFILE_H__
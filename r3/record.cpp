@@ -0,0 +1,190 @@
+/*
+ *  record
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/record.h"
+
+#include "r3/command.h"
+#include "r3/output.h"
+#include "r3/var.h"
+
+#include <string.h>
+
+using namespace std;
+using namespace r3;
+
+VarString r_backend( "r_backend", "render backend, read at init: gl or record", 0, "gl" );
+VarInteger r_recordMaxCommands( "r_recordMaxCommands", "command log length past which the record backend only counts", 0, 1 << 20 );
+
+namespace {
+	
+	const char *RecordOpName[] = {
+		"Enable",
+		"Disable",
+		"ActiveTexture",
+		"ClientActiveTexture",
+		"ClientArray",
+		"ArrayPointer",
+		"BlendFunc",
+		"DepthFunc",
+		"AlphaFunc",
+		"LineWidth",
+		"PointSize",
+		"TexEnv",
+		"Color",
+		"Matrix",
+		"Clear",
+		"DrawArrays",
+		"DrawElements",
+		"GenBuffer",
+		"DeleteBuffer",
+		"BindBuffer",
+		"BufferData",
+		"BufferSubData",
+		"GenTexture",
+		"DeleteTexture",
+		"BindTexture",
+		"TexParameter",
+		"TexImage",
+		"GenerateMipmap",
+		"Renderbuffer",
+		"Framebuffer"
+	};
+	
+	vector< RecordedCommand > commands;
+	RecordStats stats;
+	uint nextObject = 1;
+	
+	// recordstats command
+	void RecordStatsCommand( const vector< Token > & tokens ) {
+		if ( Recording() == false ) {
+			Output( "r_backend is not \"record\", nothing has been recorded." );
+			return;
+		}
+		Output( "%d commands logged, %d draws, %d verts, %d bytes uploaded",
+			   (int)commands.size(), stats.draws, stats.verts, stats.bytesUploaded );
+		for ( int i = 0; i < RecordOp_MAX; i++ ) {
+			if ( stats.ops[ i ] ) {
+				Output( "  %-20s %d", RecordOpName[ i ], stats.ops[ i ] );
+			}
+		}
+	}
+	CommandFunc RecordStatsCmd( "recordstats", "prints the record backend command counts", RecordStatsCommand );
+	
+	// recordclear command
+	void RecordClearCommand( const vector< Token > & tokens ) {
+		RecordClear();
+	}
+	CommandFunc RecordClearCmd( "recordclear", "empties the record backend command log", RecordClearCommand );
+	
+}
+
+namespace r3 {
+	
+	RenderBackendEnum renderBackend = RenderBackend_GL;
+	
+	void InitRenderBackend() {
+		if ( r_backend.GetVal() == "record" ) {
+			renderBackend = RenderBackend_Record;
+		} else {
+			if ( r_backend.GetVal() != "gl" ) {
+				Output( "Unknown r_backend \"%s\", using gl.", r_backend.GetVal().c_str() );
+			}
+			renderBackend = RenderBackend_GL;
+		}
+		Output( "r_backend = %s", renderBackend == RenderBackend_Record ? "record" : "gl" );
+	}
+	
+	void RecordStats::Clear() {
+		memset( ops, 0, sizeof( ops ) );
+		draws = verts = bytesUploaded = 0;
+	}
+	
+	void Record( RecordOpEnum op, uint target, uint arg, int count ) {
+		stats.ops[ op ]++;
+		switch ( op ) {
+			case RecordOp_DrawArrays:
+			case RecordOp_DrawElements:
+				stats.draws++;
+				stats.verts += count;
+				break;
+			case RecordOp_BufferData:
+			case RecordOp_BufferSubData:
+			case RecordOp_TexImage:
+				stats.bytesUploaded += count;
+				break;
+			default:
+				break;
+		}
+		if ( (int)commands.size() >= r_recordMaxCommands.GetVal() ) {
+			return;
+		}
+		RecordedCommand c;
+		c.op = op;
+		c.target = target;
+		c.arg = arg;
+		c.count = count;
+		commands.push_back( c );
+	}
+	
+	uint RecordGenObject() {
+		return nextObject++;
+	}
+	
+	const vector< RecordedCommand > & GetRecordedCommands() {
+		return commands;
+	}
+	
+	const RecordStats & GetRecordStats() {
+		return stats;
+	}
+	
+	const char * GetRecordOpName( RecordOpEnum op ) {
+		return op >= 0 && op < RecordOp_MAX ? RecordOpName[ op ] : "Invalid";
+	}
+	
+	void RecordClear() {
+		commands.clear();
+		stats.Clear();
+	}
+	
+}
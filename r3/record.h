@@ -0,0 +1,134 @@
+/*
+ *  record
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_RECORD_H__
+#define __R3_RECORD_H__
+
+#include "r3/common.h"
+
+#include <vector>
+
+namespace r3 {
+	
+	// The record backend stands in for GL on machines with no GPU or
+	// display.  Nothing reaches the driver, every call that would have is
+	// appended to an in-memory command log instead.  The backend is chosen
+	// by r_backend ("gl" or "record") when r3::Init() runs.
+	enum RenderBackendEnum {
+		RenderBackend_GL,
+		RenderBackend_Record
+	};
+	
+	extern RenderBackendEnum renderBackend;
+	
+	inline bool Recording() {
+		return renderBackend == RenderBackend_Record;
+	}
+	
+	void InitRenderBackend();
+	
+	enum RecordOpEnum {
+		RecordOp_Enable,
+		RecordOp_Disable,
+		RecordOp_ActiveTexture,
+		RecordOp_ClientActiveTexture,
+		RecordOp_ClientArray,
+		RecordOp_ArrayPointer,
+		RecordOp_BlendFunc,
+		RecordOp_DepthFunc,
+		RecordOp_AlphaFunc,
+		RecordOp_LineWidth,
+		RecordOp_PointSize,
+		RecordOp_TexEnv,
+		RecordOp_Color,
+		RecordOp_Matrix,
+		RecordOp_Clear,
+		RecordOp_DrawArrays,
+		RecordOp_DrawElements,
+		RecordOp_GenBuffer,
+		RecordOp_DeleteBuffer,
+		RecordOp_BindBuffer,
+		RecordOp_BufferData,
+		RecordOp_BufferSubData,
+		RecordOp_GenTexture,
+		RecordOp_DeleteTexture,
+		RecordOp_BindTexture,
+		RecordOp_TexParameter,
+		RecordOp_TexImage,
+		RecordOp_GenerateMipmap,
+		RecordOp_Renderbuffer,
+		RecordOp_Framebuffer,
+		RecordOp_MAX
+	};
+	
+	// target and arg hold the GL enum or object the call was made with,
+	// count is the number of vertices drawn or bytes uploaded
+	struct RecordedCommand {
+		RecordOpEnum op;
+		uint target;
+		uint arg;
+		int count;
+	};
+	
+	struct RecordStats {
+		RecordStats() { Clear(); }
+		void Clear();
+		int ops[ RecordOp_MAX ];
+		int draws;
+		int verts;
+		int bytesUploaded;
+	};
+	
+	void Record( RecordOpEnum op, uint target = 0, uint arg = 0, int count = 0 );
+	// object names for the Gen ops, never 0
+	uint RecordGenObject();
+	
+	const std::vector< RecordedCommand > & GetRecordedCommands();
+	const RecordStats & GetRecordStats();
+	const char * GetRecordOpName( RecordOpEnum op );
+	// empties the command log and zeroes the stats
+	void RecordClear();
+	
+}
+
+#endif // __R3_RECORD_H__
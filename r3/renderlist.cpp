@@ -0,0 +1,210 @@
+/*
+ *  renderlist
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#include "r3/renderlist.h"
+
+#include "r3/gl.h"
+
+#include <algorithm>
+#include <map>
+#include <string.h>
+
+using namespace std;
+using namespace r3;
+
+namespace r3 {
+	
+	struct RenderList::ItemCompare {
+		const vector< Item > & items;
+		ItemCompare( const vector< Item > & listItems ) : items( listItems ) {}
+		bool operator() ( int ia, int ib ) const {
+			const Item & a = items[ ia ];
+			const Item & b = items[ ib ];
+			if ( a.state.layer != b.state.layer ) {
+				return a.state.layer < b.state.layer;
+			}
+			if ( a.state.blend != b.state.blend ) {
+				return a.state.blend < b.state.blend;
+			}
+			if ( a.state.blendSrc != b.state.blendSrc ) {
+				return a.state.blendSrc < b.state.blendSrc;
+			}
+			if ( a.state.blendDst != b.state.blendDst ) {
+				return a.state.blendDst < b.state.blendDst;
+			}
+			if ( a.state.depthTest != b.state.depthTest ) {
+				return a.state.depthTest < b.state.depthTest;
+			}
+			return a.texOrder < b.texOrder;
+		}
+	};
+	
+	RenderList::RenderList( const string & listName ) : name( listName ), numDraws( 0 ) {
+		vb = new VertexBuffer( "renderList_" + name );
+	}
+	
+	void RenderList::Add( const RenderState & state, const Matrix4f & transform, const Vec4f & color,
+						  PrimitiveEnum prim, int varying, const void * data, int numVerts ) {
+		if ( numVerts <= 0 ) {
+			return;
+		}
+		Item it;
+		it.state = state;
+		it.transform = transform;
+		it.color = color;
+		it.prim = prim;
+		it.varying = varying | Varying_PositionBit;
+		it.offset = (int)verts.size();
+		it.numVerts = numVerts;
+		it.texOrder = 0;
+		int bytes = numVerts * GetVertexSize( it.varying );
+		verts.resize( verts.size() + bytes );
+		memcpy( & verts[ it.offset ], data, bytes );
+		items.push_back( it );
+	}
+	
+	bool RenderList::Mergeable( const Item & a, const Item & b ) {
+		if ( a.prim != b.prim || a.varying != b.varying ) {
+			return false;
+		}
+		if ( a.prim != Primitive_Triangles && a.prim != Primitive_Quads &&
+			 a.prim != Primitive_Lines && a.prim != Primitive_Points ) {
+			return false; // strips and fans can't be concatenated
+		}
+		if ( a.state.layer != b.state.layer || a.state.tex != b.state.tex ||
+			 a.state.blend != b.state.blend || a.state.blendSrc != b.state.blendSrc ||
+			 a.state.blendDst != b.state.blendDst || a.state.depthTest != b.state.depthTest ) {
+			return false;
+		}
+		if ( ( a.varying & Varying_ColorBit ) == 0 && !( a.color == b.color ) ) {
+			return false;
+		}
+		return a.transform == b.transform;
+	}
+	
+	void RenderList::Submit() {
+		numDraws = 0;
+		if ( items.size() == 0 ) {
+			return;
+		}
+		
+		// textures sort in the order they were first used
+		map< Texture2D *, int > texOrder;
+		for ( int i = 0; i < (int)items.size(); i++ ) {
+			Texture2D *t = items[i].state.tex;
+			if ( texOrder.count( t ) == 0 ) {
+				int order = (int)texOrder.size();
+				texOrder[ t ] = order;
+			}
+			items[i].texOrder = texOrder[ t ];
+		}
+		vector< int > order( items.size() );
+		for ( int i = 0; i < (int)order.size(); i++ ) {
+			order[i] = i;
+		}
+		stable_sort( order.begin(), order.end(), ItemCompare( items ) );
+		
+		// gather the vertex data in draw order, merging runs as we go
+		vector< Item > runs;
+		sorted.clear();
+		for ( int i = 0; i < (int)order.size(); i++ ) {
+			const Item & it = items[ order[i] ];
+			int stride = GetVertexSize( it.varying );
+			int bytes = it.numVerts * stride;
+			if ( runs.size() > 0 && Mergeable( runs.back(), it ) ) {
+				runs.back().numVerts += it.numVerts;
+			} else {
+				runs.push_back( it );
+				int offset = ( ( (int)sorted.size() + stride - 1 ) / stride ) * stride;
+				sorted.resize( offset );
+				runs.back().offset = offset;
+			}
+			sorted.insert( sorted.end(), verts.begin() + it.offset, verts.begin() + it.offset + bytes );
+		}
+		vb->SetData( (int)sorted.size(), & sorted[0], BufferUsage_Stream );
+		
+		static vector< VertexBuffer * > vvb( 1 );
+		vvb[0] = vb;
+		Texture2D *lastTex = NULL;
+		for ( int i = 0; i < (int)runs.size(); i++ ) {
+			const Item & r = runs[i];
+			if ( r.state.blend ) {
+				BlendFunc( r.state.blendSrc, r.state.blendDst );
+				BlendEnable();
+			} else {
+				BlendDisable();
+			}
+			if ( r.state.depthTest ) {
+				DepthTestEnable();
+			} else {
+				DepthTestDisable();
+			}
+			if ( r.state.tex ) {
+				r.state.tex->Bind( 0 );
+				r.state.tex->Enable();
+			} else if ( lastTex ) {
+				lastTex->Disable();
+			}
+			lastTex = r.state.tex ? r.state.tex : lastTex;
+			if ( ( r.varying & Varying_ColorBit ) == 0 ) {
+				ImColorf( r.color.x, r.color.y, r.color.z, r.color.w );
+			}
+			MatrixPush();
+			MatrixLoad( r.transform );
+			vb->SetVarying( r.varying );
+			vb->SetRange( r.offset, r.numVerts );
+			Draw( r.prim, vvb );
+			MatrixPop();
+			numDraws++;
+		}
+		if ( lastTex ) {
+			lastTex->Disable();
+		}
+		Clear();
+	}
+	
+	void RenderList::Clear() {
+		items.clear();
+		verts.clear();
+	}
+	
+}
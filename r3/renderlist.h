@@ -0,0 +1,115 @@
+/*
+ *  renderlist
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#ifndef __R3_RENDERLIST_H__
+#define __R3_RENDERLIST_H__
+
+#include "r3/buffer.h"
+#include "r3/common.h"
+#include "r3/draw.h"
+#include "r3/linear.h"
+#include "r3/texture.h"
+
+#include <string>
+#include <vector>
+
+namespace r3 {
+	
+	struct RenderState {
+		RenderState() : layer( 0 ), tex( NULL ), blend( false ), blendSrc( BlendFunc_One ), blendDst( BlendFunc_Zero ), depthTest( false ) {}
+		int layer;              // lower layers are drawn first
+		Texture2D *tex;         // NULL for untextured
+		bool blend;
+		BlendFuncEnum blendSrc;
+		BlendFuncEnum blendDst;
+		bool depthTest;
+	};
+	
+	// Deferred draws.  Items are sorted by layer, blend, depth and texture
+	// on Submit(), adjacent compatible items are merged, and all the vertex
+	// data goes to GL in a single upload.
+	class RenderList {
+	public:
+		RenderList( const std::string & listName );
+		
+		// verts are laid out as for ImVarying( varying ), transform replaces
+		// the modelview matrix, and color is used when varying has no color
+		void Add( const RenderState & state, const Matrix4f & transform, const Vec4f & color,
+				  PrimitiveEnum prim, int varying, const void * verts, int numVerts );
+		
+		bool Empty() const {
+			return items.size() == 0;
+		}
+		
+		// Draws and clears the list.  Blend and depth state are left as
+		// set by the last item, the texture is left disabled.
+		void Submit();
+		void Clear();
+		
+		int GetNumItems() const { return (int)items.size(); }
+		int GetNumDraws() const { return numDraws; }
+		
+	private:
+		struct Item {
+			RenderState state;
+			Matrix4f transform;
+			Vec4f color;
+			PrimitiveEnum prim;
+			int varying;
+			int offset;
+			int numVerts;
+			int texOrder;
+		};
+		struct ItemCompare;
+		static bool Mergeable( const Item & a, const Item & b );
+		
+		std::string name;
+		std::vector< Item > items;
+		std::vector< byte > verts;
+		std::vector< byte > sorted;
+		VertexBuffer *vb;
+		int numDraws;
+	};
+	
+}
+
+#endif // __R3_RENDERLIST_H__
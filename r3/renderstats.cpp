@@ -0,0 +1,160 @@
+/*
+ *  renderstats.cpp
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/renderstats.h"
+
+#include "r3/command.h"
+#include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/var.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace r3;
+
+VarInteger r_statDraws( "r_statDraws", "draw calls last frame", Var_ReadOnly, 0 );
+VarInteger r_statImmediateDraws( "r_statImmediateDraws", "immediate mode draws (ImEnd) last frame", Var_ReadOnly, 0 );
+VarInteger r_statPrimitives( "r_statPrimitives", "primitives drawn last frame", Var_ReadOnly, 0 );
+VarInteger r_statVerts( "r_statVerts", "vertices drawn last frame", Var_ReadOnly, 0 );
+VarInteger r_statTextureBinds( "r_statTextureBinds", "texture binds last frame", Var_ReadOnly, 0 );
+VarInteger r_statBufferBytes( "r_statBufferBytes", "buffer bytes uploaded last frame", Var_ReadOnly, 0 );
+VarInteger r_statTextureBytes( "r_statTextureBytes", "texture bytes uploaded last frame", Var_ReadOnly, 0 );
+
+namespace {
+	
+	VarInteger *statVars[] = {
+		&r_statDraws,
+		&r_statImmediateDraws,
+		&r_statPrimitives,
+		&r_statVerts,
+		&r_statTextureBinds,
+		&r_statBufferBytes,
+		&r_statTextureBytes
+	};
+	
+	const char *statNames[] = {
+		"draws",
+		"immediateDraws",
+		"primitives",
+		"verts",
+		"textureBinds",
+		"bufferBytes",
+		"textureBytes"
+	};
+	
+	int history[ RenderStat_MAX ][ R3_PROFILE_WINDOW ];
+	int numFrames;
+	int nextFrame;
+	
+	void PrintHistogram( int stat ) {
+		int lo = history[ stat ][ 0 ];
+		int hi = lo;
+		for ( int i = 1; i < numFrames; i++ ) {
+			lo = min( lo, history[ stat ][ i ] );
+			hi = max( hi, history[ stat ][ i ] );
+		}
+		const int numBuckets = 10;
+		int buckets[ numBuckets ] = { 0 };
+		int width = max( 1, ( hi - lo + numBuckets ) / numBuckets );
+		for ( int i = 0; i < numFrames; i++ ) {
+			buckets[ min( numBuckets - 1, ( history[ stat ][ i ] - lo ) / width ) ]++;
+		}
+		int most = *max_element( buckets, buckets + numBuckets );
+		Output( "%s over %d frames:", statNames[ stat ], numFrames );
+		for ( int b = 0; b < numBuckets && lo + b * width <= hi; b++ ) {
+			string bar( ( buckets[ b ] * 40 + most - 1 ) / most, '#' );
+			Output( "  %10d - %-10d %4d %s", lo + b * width, lo + ( b + 1 ) * width - 1, buckets[ b ], bar.c_str() );
+		}
+	}
+	
+	// renderstats command
+	void RenderStatsCommand( const vector< Token > & tokens ) {
+		if ( numFrames == 0 ) {
+			Output( "No frames counted yet." );
+			return;
+		}
+		if ( tokens.size() > 1 ) {
+			for ( int i = 0; i < RenderStat_MAX; i++ ) {
+				if ( tokens[1].valString == statNames[ i ] ) {
+					PrintHistogram( i );
+					return;
+				}
+			}
+			Output( "Unknown render stat %s.", tokens[1].valString.c_str() );
+			return;
+		}
+		Output( "%-16s %10s %10s %10s   (per frame, last %d frames)", "stat", "min", "avg", "max", numFrames );
+		for ( int i = 0; i < RenderStat_MAX; i++ ) {
+			int lo = history[ i ][ 0 ];
+			int hi = lo;
+			double sum = 0;
+			for ( int j = 0; j < numFrames; j++ ) {
+				lo = min( lo, history[ i ][ j ] );
+				hi = max( hi, history[ i ][ j ] );
+				sum += history[ i ][ j ];
+			}
+			Output( "%-16s %10d %10.1f %10d", statNames[ i ], lo, sum / numFrames, hi );
+		}
+	}
+	CommandFunc RenderStatsCmd( "renderstats", "renderstats [stat] - per frame render counts, or a histogram of one of them", RenderStatsCommand );
+	
+}
+
+namespace r3 {
+	
+	int renderStats[ RenderStat_MAX ];
+	
+	void RenderStatsFrame() {
+		for ( int i = 0; i < RenderStat_MAX; i++ ) {
+			statVars[ i ]->SetVal( renderStats[ i ] );
+			history[ i ][ nextFrame ] = renderStats[ i ];
+			renderStats[ i ] = 0;
+		}
+		nextFrame = ( nextFrame + 1 ) % R3_PROFILE_WINDOW;
+		numFrames = min( numFrames + 1, R3_PROFILE_WINDOW );
+	}
+	
+}
@@ -0,0 +1,74 @@
+/*
+ *  renderstats.h
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_RENDERSTATS_H__
+#define __R3_RENDERSTATS_H__
+
+namespace r3 {
+	
+	// Per frame counts of the work handed to the driver, or to the record
+	// backend.  The counts for the last frame are mirrored into read-only
+	// r_stat* vars, and "renderstats" summarizes the recent frames.
+	enum RenderStatEnum {
+		RenderStat_Draws,
+		RenderStat_ImmediateDraws,
+		RenderStat_Primitives,
+		RenderStat_Verts,
+		RenderStat_TextureBinds,
+		RenderStat_BufferBytes,
+		RenderStat_TextureBytes,
+		RenderStat_MAX
+	};
+	
+	extern int renderStats[ RenderStat_MAX ];
+	
+	inline void CountRenderStat( RenderStatEnum stat, int n = 1 ) {
+		renderStats[ stat ] += n;
+	}
+	
+	// Called by ProfileFrame(), publishes and zeroes the counts.
+	void RenderStatsFrame();
+	
+}
+
+#endif // __R3_RENDERSTATS_H__
@@ -42,6 +42,8 @@
 #include "r3/rendertarget.h"
 
 #include "r3/gl.h"
+#include "r3/output.h"
+#include "r3/record.h"
 
 #include <assert.h>
 
@@ -76,11 +78,22 @@ namespace r3 {
 	: format( rbFormat )
 	, width( rbWidth )
 	, height( rbHeight ) {
+		if ( Recording() ) {
+			obj = RecordGenObject();
+			Record( RecordOp_Renderbuffer, GL_RENDERBUFFER_EXT, obj );
+			return;
+		}
 		glGenRenderbuffersEXT( 1, & obj );
+		glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, obj );
 		glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GlRenderBufferFormat[ format ], width, height);
+		glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, 0 );
 	}
 	
 	RenderBuffer::~RenderBuffer() {
+		if ( Recording() ) {
+			Record( RecordOp_Renderbuffer, GL_RENDERBUFFER_EXT, obj );
+			return;
+		}
 		glDeleteRenderbuffersEXT( 1, & obj );
 	}
 	
@@ -89,13 +102,85 @@ namespace r3 {
 	}
 	
 	void RenderBuffer::Bind() {
+		if ( Recording() ) {
+			Record( RecordOp_Renderbuffer, GL_RENDERBUFFER_EXT, obj );
+			return;
+		}
 		glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, obj );
 	}
 	
 	void RenderBuffer::Unbind() {
+		if ( Recording() ) {
+			Record( RecordOp_Renderbuffer, GL_RENDERBUFFER_EXT, 0 );
+			return;
+		}
 		glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, 0 );
 	}
 	
+	
+	FrameBuffer::FrameBuffer( Texture2D *fbColor ) 
+	: color( fbColor )
+	, obj( 0 )
+	, complete( false )
+	, prevObj( 0 ) {
+		if ( Recording() ) {
+			obj = RecordGenObject();
+			Record( RecordOp_Framebuffer, GL_FRAMEBUFFER_EXT, obj );
+			complete = true;
+			return;
+		}
+		glGenFramebuffersEXT( 1, & obj );
+		Bind();
+		glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, color->Object(), 0 );
+		complete = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT ) == GL_FRAMEBUFFER_COMPLETE_EXT;
+		Unbind();
+	}
+	
+	FrameBuffer::~FrameBuffer() {
+		if ( Recording() ) {
+			Record( RecordOp_Framebuffer, GL_FRAMEBUFFER_EXT, obj );
+		} else {
+			glDeleteFramebuffersEXT( 1, & obj );
+		}
+		delete color;
+	}
+	
+	FrameBuffer * FrameBuffer::Create( const std::string & name, int width, int height ) {
+		Texture2D *tex = Texture2D::Create( name, TextureFormat_RGBA, width, height );
+		if ( tex == NULL ) {
+			return NULL;
+		}
+		// only level 0 is ever drawn, so sampling must not reach for mips
+		tex->SetSampler( SamplerParams( TextureFilter_Linear, TextureFilter_Linear, TextureFilter_None, 0.0f, 0.0f, 0.0f, 1.0f ) );
+		tex->SetImage( 0, NULL );
+		FrameBuffer *fb = new FrameBuffer( tex );
+		if ( fb->complete == false ) {
+			Output( "FrameBuffer \"%s\" (%dx%d) is not complete.  Returning NULL.", name.c_str(), width, height );
+			delete fb;
+			return NULL;
+		}
+		return fb;
+	}
+	
+	void FrameBuffer::Bind() {
+		if ( Recording() ) {
+			Record( RecordOp_Framebuffer, GL_FRAMEBUFFER_EXT, obj );
+			return;
+		}
+		glGetIntegerv( GL_FRAMEBUFFER_BINDING_EXT, & prevObj );
+		glGetIntegerv( GL_VIEWPORT, prevViewport );
+		glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, obj );
+		glViewport( 0, 0, color->Width(), color->Height() );
+	}
+	
+	void FrameBuffer::Unbind() {
+		if ( Recording() ) {
+			Record( RecordOp_Framebuffer, GL_FRAMEBUFFER_EXT, 0 );
+			return;
+		}
+		glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, prevObj );
+		glViewport( prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3] );
+	}
+	
 }
 
-
@@ -61,6 +61,34 @@ namespace r3 {
 		void Unbind();
 	};
 	
+	// An offscreen color target that can be sampled as a texture once
+	// drawn.  Bind() points drawing and the viewport at it, and Unbind()
+	// puts back whatever framebuffer and viewport were current, since the
+	// window's framebuffer is not always object 0.
+	class FrameBuffer {
+		Texture2D *color;
+		uint obj;
+		bool complete;
+		int prevObj;
+		int prevViewport[4];
+		FrameBuffer( Texture2D *fbColor );
+	public:
+		~FrameBuffer();
+		// NULL if the name is in use or the target is not drawable
+		static FrameBuffer *Create( const std::string & name, int width, int height );
+		Texture2D *GetColorTexture() {
+			return color;
+		}
+		int Width() const {
+			return color->Width();
+		}
+		int Height() const {
+			return color->Height();
+		}
+		void Bind();
+		void Unbind();
+	};
+	
 }
 
 #endif // __R3_RENDERTARGET_H__
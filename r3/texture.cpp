@@ -44,11 +44,23 @@
 #include "r3/texture.h"
 
 #include "r3/command.h"
-#include "r3/image.h"
+#include "r3/common.h"
+#include "r3/draw.h"
+#include "r3/memtrack.h"
 #include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/record.h"
+#include "r3/renderstats.h"
+#include "r3/texturecache.h"
+#include "r3/thread.h"
+#include "r3/time.h"
+#include "r3/trace.h"
+#include "r3/var.h"
 
 #include "r3/gl.h"
 
+#include <algorithm>
+#include <deque>
 #include <map>
 
 #include <assert.h>
@@ -88,6 +100,16 @@ namespace {
 		0                           // TextureFormat_MAX
 	};
 	
+	const int FormatBytes[] = {
+		0,                          // TextureFormat_INVALID,
+		1,                          // TextureFormat_L,
+		2,                          // TextureFormat_LA,
+		3,                          // TextureFormat_RGB,
+		4,                          // TextureFormat_RGBA,
+		2,                          // TextureFormat_DepthComponent,
+		0                           // TextureFormat_MAX
+	};
+	
 	const char *FormatString[] = {
 		"INVALID",                  // TextureFormat_INVALID,
 		"L",                        // TextureFormat_L,
@@ -147,12 +169,21 @@ namespace {
 		void AddTexture( const string & name, Texture * tex ) {
 			assert( textures.count( name ) == 0 );
 			GLuint obj;
-			glGenTextures( 1, & obj );
+			if ( Recording() ) {
+				obj = RecordGenObject();
+				Record( RecordOp_GenTexture, 0, obj );
+			} else {
+				glGenTextures( 1, & obj );
+			}
 			textures[ name ] = TexInfo( obj, tex );
 		}
 		void DeleteTexture( const string & name ) {
-			assert( textures.count( name ) == 0 );
-			glDeleteTextures( 1, & textures[name].obj );
+			assert( textures.count( name ) == 1 );
+			if ( Recording() ) {
+				Record( RecordOp_DeleteTexture, 0, textures[name].obj );
+			} else {
+				glDeleteTextures( 1, & textures[name].obj );
+			}
 			textures.erase( name );
 		}
 	};
@@ -160,6 +191,20 @@ namespace {
 	
 	int modBindUnit = 0; // what texture unit is used for "bind for modification"?
 	
+	// SetImage() always generates mipmaps, so the whole chain is resident
+	int MipChainBytes( int w, int h, TextureFormatEnum f ) {
+		int bytes = 0;
+		for ( ;; ) {
+			bytes += w * h * FormatBytes[ f ];
+			if ( w == 1 && h == 1 ) {
+				break;
+			}
+			w = max( 1, w >> 1 );
+			h = max( 1, h >> 1 );
+		}
+		return bytes;
+	}
+	
 	bool initialized = false;
 	
 	// listTextures command
@@ -176,16 +221,100 @@ namespace {
 			case TextureTarget_2D:
 				{
 					Texture2D *t = (Texture2D *)ti.tex;
-					Output( "2D - w=%d h=%d fmt=%s - %s", t->Width(), t->Height(), fmt, n.c_str() );					
+					int kb = MipChainBytes( t->Width(), t->Height(), t->Format() ) >> 10;
+					Output( "2D - w=%d h=%d fmt=%s kb=%d - %s", t->Width(), t->Height(), fmt, kb, n.c_str() );					
 				}
 				break;
 			default:
 				break;
 			}
 		}
+		Output( "%d textures, %d KB with mipmaps", (int)textures.size(), MemoryTotal( MemoryCategory_Texture ) >> 10 );
 	}
 	CommandFunc ListTexturesCmd( "listtextures", "lists defined textures", ListTextures );
 	
+	VarBool r_asyncTextureLoads( "r_asyncTextureLoads", "decode textures from files on worker threads", 0, true );
+	VarInteger r_textureLoadThreads( "r_textureLoadThreads", "threads decoding textures, 0 for one per processor", 0, 0 );
+	VarFloat r_textureUploadMs( "r_textureUploadMs", "milliseconds per frame spent uploading decoded textures", 0, 4.0f );
+	
+	// A file being read and decoded off the GL thread for a placeholder
+	// texture.  Jobs wait in loadQueue for a thread, then in loadDone for
+	// UploadLoadedTextures().
+	struct TextureLoad {
+		TextureLoad() : format( TextureFormat_INVALID ), tex( NULL ), chain( NULL ), loaded( false ) {}
+		string filename;
+		TextureFormatEnum format;
+		Texture2D *tex;
+		MipChain *chain;
+		bool loaded;
+		vector< string > messages; // Output() from the decode
+	};
+	
+	Mutex loadMutex;
+	deque< TextureLoad > loadQueue;
+	deque< TextureLoad > loadDone;
+	int loadsPending;    // GL thread only
+	int loadGeneration;  // GL thread only
+	ProfileTimer uploadTimer( "uploadTextures" );
+	
+	struct TextureLoadThread : public Thread {
+		TextureLoadThread() : busy( false ), started( false ) {}
+		bool busy;     // guarded by loadMutex
+		bool started;
+		virtual void Run() {
+			TraceThreadName( "TextureLoadThread" );
+			for ( ;; ) {
+				TextureLoad tl;
+				{
+					ScopedMutex m( loadMutex );
+					if ( loadQueue.empty() ) {
+						busy = false;
+						return;
+					}
+					tl = loadQueue.front();
+					loadQueue.pop_front();
+				}
+				{
+					TraceScope ts( "decodeTexture" );
+					tl.chain = new MipChain;
+					// the console belongs to the GL thread
+					CaptureOutput( & tl.messages );
+					tl.loaded = LoadMipChain( tl.filename, tl.format, *tl.chain );
+					CaptureOutput( NULL );
+				}
+				ScopedMutex m( loadMutex );
+				loadDone.push_back( tl );
+			}
+		}
+	};
+	vector< TextureLoadThread * > loadThreads;
+	
+	// Start enough idle threads for the queue.  A busy thread checks the
+	// queue again before it quits, so it will pick up new jobs on its own.
+	// Called with loadMutex held.
+	void StartTextureLoadThreads() {
+		if ( loadThreads.empty() ) {
+			int n = r_textureLoadThreads.GetVal();
+			n = n > 0 ? n : GetNumProcessors();
+			for ( int i = 0; i < n; i++ ) {
+				loadThreads.push_back( new TextureLoadThread );
+			}
+		}
+		int waiting = (int)loadQueue.size();
+		for ( int i = 0; i < (int)loadThreads.size() && waiting > 0; i++ ) {
+			TextureLoadThread *t = loadThreads[i];
+			if ( t->busy ) {
+				continue;
+			}
+			if ( t->started ) {
+				t->Join();
+			}
+			t->busy = t->started = true;
+			t->Start();
+			waiting--;
+		}
+	}
+	
 	
 	
 }
@@ -207,34 +336,62 @@ namespace r3 {
 		SetSampler( sampler );
 	}
 
+	Texture *textureBindShadow[16];
+	
 	Texture::~Texture() {
+		MemoryTrack( MemoryCategory_Texture, name, 0 );
 		textureDatabase->DeleteTexture( name );
+		// a texture allocated at the same address must not look bound
+		for ( int i = 0; i < ARRAY_ELEMENTS( textureBindShadow ); i++ ) {
+			if ( textureBindShadow[ i ] == this ) {
+				textureBindShadow[ i ] = NULL;
+			}
+		}
 	}
 	
 	
-	Texture *textureBindShadow[16];
+	void InvalidateTextureBindings() {
+		for ( int i = 0; i < ARRAY_ELEMENTS( textureBindShadow ); i++ ) {
+			textureBindShadow[ i ] = NULL;
+		}
+	}
 	
 	void Texture::Bind( int imageUnit ) {
+		// Enable() and Disable() apply to the active unit, even when
+		// the bind itself is redundant
+		StateActiveTexture( imageUnit );
 		if ( textureBindShadow[ imageUnit ] == this ) {
 			return;
 		}
-		glActiveTexture( GL_TEXTURE0 + imageUnit );
-		glBindTexture( GlTarget[ target ], textureDatabase->GetTextureObject( name ) );
+		CountRenderStat( RenderStat_TextureBinds );
+		if ( Recording() ) {
+			Record( RecordOp_BindTexture, GlTarget[ target ], textureDatabase->GetTextureObject( name ) );
+		} else {
+			glBindTexture( GlTarget[ target ], textureDatabase->GetTextureObject( name ) );
+		}
 		textureBindShadow[ imageUnit ] = this;
 	}
 	
+	uint Texture::Object() {
+		return textureDatabase->GetTextureObject( name );
+	}
+	
 	void Texture::Enable() {
-		glEnable( GlTarget[ target ] );
+		StateEnable( GlTarget[ target ], true, true );
 	}
 
 	void Texture::Disable() {
-		glDisable( GlTarget[ target ] );
+		StateEnable( GlTarget[ target ], false, true );
 	}
 	
 	void Texture::SetSampler( const SamplerParams & s ) {
 		Bind(modBindUnit);
 		sampler = s;
 		GLenum t = GlTarget[ target ];
+		if ( Recording() ) {
+			Record( RecordOp_TexParameter, t );
+			return;
+		}
 		glTexParameteri( t, GL_TEXTURE_MAG_FILTER, GlMagFilt[ s.magFilter ] );
 		glTexParameteri( t, GL_TEXTURE_MIN_FILTER, GlMipMinFilt[ s.mipFilter ][ s.minFilter ] );
 		glTexParameterf( t, GL_TEXTURE_LOD_BIAS, s.levelBias );
@@ -257,23 +414,151 @@ namespace r3 {
 	}
 
 		
+	void Texture2D::SetLevel( int level, const void *data ) {
+		int w = max( 1, width >> level );
+		int h = max( 1, height >> level );
+		int rowBytes = w * FormatBytes[ Format() ];
+		if ( data ) {
+			CountRenderStat( RenderStat_TextureBytes, rowBytes * h );
+		}
+		if ( Recording() ) {
+			Record( RecordOp_TexImage, GlTarget[ Target() ], level, rowBytes * h );
+			return;
+		}
+		// rows are tightly packed, which small RGB levels are not by default
+		if ( rowBytes & 3 ) {
+			glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		}
+		glTexImage2D( GlTarget[ Target() ], level, GlInternalFormat[ Format() ], w, h, 0, GlFormat[ Format() ], GL_UNSIGNED_BYTE, data );
+		if ( rowBytes & 3 ) {
+			glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+		}
+	}
+	
 	void Texture2D::SetImage( int level, void *data ) {
-		glTexImage2D( GlTarget[ Target() ], level, GlInternalFormat[ Format() ], width, height, 0, GlFormat[ Format() ], GL_UNSIGNED_BYTE, data );
+		if ( level == 0 ) {
+			MemoryTrack( MemoryCategory_Texture, Name(), MipChainBytes( width, height, Format() ) );
+		}
+		SetLevel( level, data );
+		if ( Recording() ) {
+			Record( RecordOp_GenerateMipmap, GlTarget[ Target() ] );
+			return;
+		}
 		glGenerateMipmapEXT( GlTarget[ Target() ] );
 	}
 	
+	void Texture2D::SetMipChain( const MipChain & chain ) {
+		assert( chain.width == width && chain.height == height && chain.components == FormatBytes[ Format() ] );
+		if ( chain.levels < 2 ) {
+			SetImage( 0, (void *)& chain.data[0] );
+			return;
+		}
+		MemoryTrack( MemoryCategory_Texture, Name(), (int)chain.data.size() );
+		for ( int i = 0; i < chain.levels; i++ ) {
+			SetLevel( i, & chain.data[ chain.LevelOffset( i ) ] );
+		}
+	}
+	
+	Texture2D * CreateTexture2DFromFileAsync( const std::string & filename, TextureFormatEnum f ) {
+		Texture2D * tex;
+		if ( r_asyncTextureLoads.GetVal() == false || f == TextureFormat_INVALID ||
+			 textureDatabase->GetTexture( filename ) ) {
+			return CreateTexture2DFromFile( filename, f );
+		}
+		tex = Texture2D::Create( filename, f, 1, 1 );
+		unsigned char placeholder[4] = { 0, 0, 0, 0 };
+		tex->SetImage( 0, placeholder );
+		
+		TextureLoad tl;
+		tl.filename = filename;
+		tl.format = f;
+		tl.tex = tex;
+		loadsPending++;
+		ScopedMutex m( loadMutex );
+		loadQueue.push_back( tl );
+		StartTextureLoadThreads();
+		return tex;
+	}
+	
+	void UploadLoadedTextures() {
+		if ( loadsPending == 0 ) {
+			return;
+		}
+		ProfileScope ps( uploadTimer );
+		double start = GetTime();
+		double budget = r_textureUploadMs.GetVal() / 1000.0;
+		bool uploaded = false;
+		// at least one per frame, however small the budget
+		do {
+			TextureLoad tl;
+			{
+				ScopedMutex m( loadMutex );
+				if ( loadDone.empty() ) {
+					break;
+				}
+				tl = loadDone.front();
+				loadDone.pop_front();
+			}
+			loadsPending--;
+			for ( int i = 0; i < (int)tl.messages.size(); i++ ) {
+				Output( "%s", tl.messages[i].c_str() );
+			}
+			MipChain *chain = tl.chain;
+			// the texture may have been deleted while its file was decoding
+			if ( textureDatabase->GetTexture( tl.filename ) != tl.tex ) {
+				delete chain;
+				continue;
+			}
+			if ( tl.loaded == false ) {
+				Output( "Failed to load image %s, keeping placeholder", tl.filename.c_str() );
+				delete chain;
+				continue;
+			}
+			tl.tex->width = chain->width;
+			tl.tex->height = chain->height;
+			tl.tex->SetMipChain( *chain );
+			Output( "Loaded image %s (w=%d, h=%d, levels=%d)", tl.filename.c_str(), chain->width, chain->height, chain->levels );
+			delete chain;
+			loadGeneration++;
+			uploaded = true;
+		} while ( GetTime() - start < budget );
+		if ( uploaded ) {
+			RequestRedraw();
+		}
+	}
+	
+	void FinishTextureLoads() {
+		while ( loadsPending > 0 ) {
+			UploadLoadedTextures();
+			if ( loadsPending > 0 ) {
+				SleepMilliseconds( 1 );
+			}
+		}
+	}
+	
+	int TextureLoadsPending() {
+		return loadsPending;
+	}
+	
+	int TextureLoadGeneration() {
+		return loadGeneration;
+	}
+	
 	Texture2D * CreateTexture2DFromFile( const std::string & filename, TextureFormatEnum f ) {
 		Texture2D * tex;
 		if ( tex = (Texture2D *)textureDatabase->GetTexture( filename ) ) {
 			Output( "Returned already loaded texture %s", filename.c_str() );
 			return tex;
 		}
-		Image<unsigned char> * img = LoadStbImage( filename, f );
+		MipChain chain;
+		if ( LoadMipChain( filename, f, chain ) == false ) {
+			Output( "Failed to load image %s", filename.c_str() );
+			return NULL;
+		}
 		
-		tex = Texture2D::Create( filename, (TextureFormatEnum)img->Components(), img->Width(), img->Height() );
-		tex->SetImage( 0, img->Data() );
-		Output( "Loaded image %s (w=%d, h=%d)", filename.c_str(), img->Width(), img->Height() );
-		delete img;
+		tex = Texture2D::Create( filename, (TextureFormatEnum)chain.components, chain.width, chain.height );
+		tex->SetMipChain( chain );
+		Output( "Loaded image %s (w=%d, h=%d, levels=%d)", filename.c_str(), chain.width, chain.height, chain.levels );
 		return tex;
 	}
 	
@@ -44,6 +44,8 @@
 #ifndef __R3_TEXTURE_H__
 #define __R3_TEXTURE_H__
 
+#include "r3/common.h"
+
 #include <string>
 
 namespace r3 {
@@ -128,6 +130,9 @@ namespace r3 {
 			return target;
 		}
 		
+		// GL object name, for attaching to a framebuffer
+		uint Object();
+		
 		const SamplerParams & Sampler() const {
 			return sampler;
 		}
@@ -135,10 +140,14 @@ namespace r3 {
 		
 	};
 	
+	class MipChain;
+	
 	class Texture2D : public Texture {
 		int width;
 		int height;
 		Texture2D( const std::string & n, TextureFormatEnum f, int w, int h );
+		void SetLevel( int level, const void *data );
+		friend void UploadLoadedTextures();
 	public:
 		static Texture2D *Create( const std::string &n, TextureFormatEnum f, int w, int h );
 		int Width() const {
@@ -149,10 +158,34 @@ namespace r3 {
 			return height;
 		}
 		
+		// sets one level and regenerates the others from level 0
 		void SetImage( int level, void *data );
+		// sets every level from a chain of the texture's size, generating
+		// them only if the chain has just level 0
+		void SetMipChain( const MipChain & chain );
 	};
 	
 	Texture2D * CreateTexture2DFromFile( const std::string & filename, TextureFormatEnum f = TextureFormat_INVALID );
+	
+	// Like CreateTexture2DFromFile(), but the file is read and decoded on
+	// worker threads.  The texture is returned at once as a 1x1 transparent
+	// placeholder, and takes on the file's size and image when
+	// UploadLoadedTextures() gets to it.  Loads synchronously when
+	// r_asyncTextureLoads is off or no format is given.
+	Texture2D * CreateTexture2DFromFileAsync( const std::string & filename, TextureFormatEnum f );
+	
+	// Called once a frame on the GL thread.  Uploads decoded images for
+	// up to r_textureUploadMs, and requests a redraw if any landed.
+	void UploadLoadedTextures();
+	
+	// uploads every outstanding load, waiting for decodes as needed
+	void FinishTextureLoads();
+	
+	// loads still decoding or waiting to be uploaded
+	int TextureLoadsPending();
+	
+	// bumped each time a loaded image replaces a placeholder
+	int TextureLoadGeneration();
 
 	
 }
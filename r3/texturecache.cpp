@@ -0,0 +1,220 @@
+/*
+ *  texturecache
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/texturecache.h"
+
+#include "r3/filesystem.h"
+#include "r3/image.h"
+#include "r3/output.h"
+#include "r3/trace.h"
+#include "r3/var.h"
+
+#include <string.h>
+
+using namespace std;
+using namespace r3;
+
+VarBool r_textureCache( "r_textureCache", "keep decoded textures with their mip chains under f_cachePath", Var_Archive, true );
+
+namespace r3 {
+	extern VarString f_cachePath;
+}
+
+namespace {
+	
+	const int MipCacheMagic = 0x4d495043; // "MIPC"
+	const int MipCacheVersion = 1;
+	
+	// FNV-1a, enough to tell an edited file from the one cached
+	uint HashBytes( const vector< uchar > & v ) {
+		uint h = 2166136261u;
+		for ( int i = 0; i < (int)v.size(); i++ ) {
+			h = ( h ^ v[i] ) * 16777619u;
+		}
+		return h;
+	}
+	
+	string MipCacheName( const string & filename, int components ) {
+		char c[16];
+		r3Sprintf( c, ".%d.mip", components );
+		return "texcache/" + filename + c;
+	}
+	
+	// header, then the whole chain in one block
+	struct MipCacheHeader {
+		int magic;
+		int version;
+		uint sourceHash;
+		int sourceSize;
+		int requested;     // components asked for, 0 for the file's own
+		int width;
+		int height;
+		int components;
+		int levels;
+		int bytes;
+	};
+	
+	bool ReadMipCache( const string & name, uint hash, int size, int requested, MipChain & chain ) {
+		File * f = FileOpenForRead( name );
+		if ( f == NULL ) {
+			return false;
+		}
+		MipCacheHeader h;
+		bool ok = f->Read( &h, sizeof( h ), 1 ) == 1 &&
+			h.magic == MipCacheMagic && h.version == MipCacheVersion &&
+			h.sourceHash == hash && h.sourceSize == size && h.requested == requested &&
+			h.width > 0 && h.height > 0 && h.components > 0 && h.components <= 4 && h.levels > 0;
+		if ( ok ) {
+			chain.width = h.width;
+			chain.height = h.height;
+			chain.components = h.components;
+			chain.levels = h.levels;
+			ok = chain.LevelOffset( h.levels ) == h.bytes;
+		}
+		if ( ok ) {
+			chain.data.resize( h.bytes );
+			ok = f->Read( & chain.data[0], 1, h.bytes ) == h.bytes;
+		}
+		delete f;
+		if ( ok == false ) {
+			Output( "Ignoring stale or invalid texture cache %s", name.c_str() );
+			chain = MipChain();
+		}
+		return ok;
+	}
+	
+	void WriteMipCache( const string & name, uint hash, int size, int requested, const MipChain & chain ) {
+		File * f = FileOpenForWrite( name );
+		if ( f == NULL ) {
+			return;
+		}
+		MipCacheHeader h;
+		h.magic = MipCacheMagic;
+		h.version = MipCacheVersion;
+		h.sourceHash = hash;
+		h.sourceSize = size;
+		h.requested = requested;
+		h.width = chain.width;
+		h.height = chain.height;
+		h.components = chain.components;
+		h.levels = chain.levels;
+		h.bytes = (int)chain.data.size();
+		f->Write( &h, sizeof( h ), 1 );
+		f->Write( & chain.data[0], 1, h.bytes );
+		delete f;
+	}
+	
+}
+
+namespace r3 {
+	
+	int MipChain::LevelOffset( int level ) const {
+		int offset = 0;
+		for ( int i = 0; i < level; i++ ) {
+			offset += LevelWidth( i ) * LevelHeight( i ) * components;
+		}
+		return offset;
+	}
+	
+	void MipChain::Build( int w, int h, int c, const uchar *level0, bool fullChain ) {
+		width = w;
+		height = h;
+		components = c;
+		levels = 1;
+		while ( fullChain && ( LevelWidth( levels - 1 ) > 1 || LevelHeight( levels - 1 ) > 1 ) ) {
+			levels++;
+		}
+		data.resize( LevelOffset( levels ) );
+		memcpy( & data[0], level0, w * h * c );
+		for ( int l = 1; l < levels; l++ ) {
+			int sw = LevelWidth( l - 1 );
+			int sh = LevelHeight( l - 1 );
+			int dw = LevelWidth( l );
+			int dh = LevelHeight( l );
+			const uchar *src = LevelData( l - 1 );
+			uchar *dst = LevelData( l );
+			for ( int j = 0; j < dh; j++ ) {
+				// a dimension already at 1 repeats its only texel
+				const uchar *r0 = src + min( 2 * j, sh - 1 ) * sw * c;
+				const uchar *r1 = src + min( 2 * j + 1, sh - 1 ) * sw * c;
+				for ( int i = 0; i < dw; i++ ) {
+					int i0 = min( 2 * i, sw - 1 ) * c;
+					int i1 = min( 2 * i + 1, sw - 1 ) * c;
+					for ( int k = 0; k < c; k++ ) {
+						*dst++ = uchar( ( r0[ i0 + k ] + r0[ i1 + k ] + r1[ i0 + k ] + r1[ i1 + k ] + 2 ) >> 2 );
+					}
+				}
+			}
+		}
+	}
+	
+	bool LoadMipChain( const std::string & filename, int components, MipChain & chain ) {
+		vector< uchar > file;
+		if ( FileReadToMemory( filename, file ) == false || file.size() == 0 ) {
+			return false;
+		}
+		bool useCache = r_textureCache.GetVal() && f_cachePath.GetVal().size() > 0;
+		uint hash = HashBytes( file );
+		string cacheName = MipCacheName( filename, components );
+		if ( useCache ) {
+			TraceScope ts( "readTextureCache" );
+			if ( ReadMipCache( cacheName, hash, (int)file.size(), components, chain ) ) {
+				return true;
+			}
+		}
+		
+		Image<uchar> * img = LoadStbImage( file, components );
+		if ( img->Data() == NULL ) {
+			delete img;
+			return false;
+		}
+		chain.Build( img->Width(), img->Height(), img->Components(), (const uchar *)img->Data(), useCache );
+		delete img;
+		if ( useCache ) {
+			TraceScope ts( "writeTextureCache" );
+			WriteMipCache( cacheName, hash, (int)file.size(), components, chain );
+		}
+		return true;
+	}
+	
+}
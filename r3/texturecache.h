@@ -0,0 +1,93 @@
+/*
+ *  texturecache
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_TEXTURECACHE_H__
+#define __R3_TEXTURECACHE_H__
+
+#include "r3/common.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace r3 {
+	
+	// Decoded pixels for the levels of a texture, level 0 first and each
+	// level half the size of the one before.  A full chain runs down to
+	// 1x1, a chain with only level 0 leaves the rest to the driver.  Rows
+	// run bottom up, as with loaded images.
+	class MipChain {
+	public:
+		MipChain() : width( 0 ), height( 0 ), components( 0 ), levels( 0 ) {}
+		int width;
+		int height;
+		int components;
+		int levels;
+		std::vector< uchar > data;
+		
+		int LevelWidth( int level ) const {
+			return std::max( 1, width >> level );
+		}
+		int LevelHeight( int level ) const {
+			return std::max( 1, height >> level );
+		}
+		int LevelOffset( int level ) const;
+		uchar * LevelData( int level ) {
+			return & data[ LevelOffset( level ) ];
+		}
+		
+		// box filters level 0 down to 1x1, or just copies it
+		void Build( int w, int h, int c, const uchar *level0, bool fullChain );
+	};
+	
+	// Loads a file decoded to the given number of components, 0 for what
+	// the file has.  With r_textureCache on and an f_cachePath, the full
+	// chain comes from texcache/ when it was built from the same file
+	// contents, otherwise the file is decoded, filtered and written there
+	// for next time.  Without a cache only level 0 is returned.  Safe from
+	// any thread.
+	bool LoadMipChain( const std::string & filename, int components, MipChain & chain );
+	
+}
+
+#endif // __R3_TEXTURECACHE_H__
@@ -42,6 +42,11 @@
  */
 
 #include "r3/thread.h"
+#include "r3/trace.h"
+
+#if __APPLE__ || __linux__
+# include <unistd.h>
+#endif
 
 using namespace r3;
 
@@ -51,7 +56,7 @@ namespace  {
 	
 }
 
-#ifdef __APPLE__
+#if __APPLE__ || __linux__
 void *r3ThreadStart( void *data ) 
 #elif _WIN32
 DWORD WINAPI r3ThreadStart( LPVOID data )
@@ -63,7 +68,11 @@ DWORD WINAPI r3ThreadStart( LPVOID data )
 	numThreads++;
 	mainThreadMutex.Release();
 	
-	thread->Run();
+	{
+		TraceScope ts( "Thread::Run" );
+		thread->Run();
+	}
+	TraceThreadExit();
 	
 	mainThreadMutex.Acquire();
 	numThreads--;
@@ -83,13 +92,32 @@ namespace r3 {
 			return;
 		}
 		running = true;
-#ifdef __APPLE__
+#if __APPLE__ || __linux__
 		pthread_create( &threadId, NULL, r3ThreadStart, this );
 #elif _WIN32
 		threadId = CreateThread( NULL, 0, r3ThreadStart, this, 0, NULL );
 #endif
 	}
 	
+	void Thread::Join() {
+#if __APPLE__ || __linux__
+		pthread_join( threadId, NULL );
+#elif _WIN32
+		WaitForSingleObject( threadId, INFINITE );
+		CloseHandle( threadId );
+#endif
+	}
+	
+	int GetNumProcessors() {
+#if __APPLE__ || __linux__
+		long n = sysconf( _SC_NPROCESSORS_ONLN );
+		return n > 0 ? int( n ) : 1;
+#elif _WIN32
+		SYSTEM_INFO si;
+		GetSystemInfo( & si );
+		return si.dwNumberOfProcessors > 0 ? int( si.dwNumberOfProcessors ) : 1;
+#endif
+	}
 	
 }
 
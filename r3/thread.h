@@ -44,7 +44,7 @@
 #ifndef __R3_THREAD_H__
 #define __R3_THREAD_H__
 
-#ifdef __APPLE__
+#if __APPLE__ || __linux__
 # include <pthread.h>
 #elif _WIN32
 # include <windows.h>
@@ -56,7 +56,10 @@ namespace r3 {
 	
 	void InitThread();
 	
-#ifdef __APPLE__
+	// number of processors available, at least 1
+	int GetNumProcessors();
+	
+#if __APPLE__ || __linux__
 	class Mutex {
 		pthread_mutex_t mutex;
 	public:
@@ -76,8 +79,12 @@ namespace r3 {
 	public:
 		Thread() : running( false ) {
 		}
+		virtual ~Thread() {
+		}
 		bool running;
 		void Start();
+		// waits for Run() to return, only once per Start()
+		void Join();
 		virtual void Run() = 0;
 	};
 #elif _WIN32
@@ -103,8 +110,12 @@ namespace r3 {
 	public:
 		Thread() : running( false ) {
 		}
+		virtual ~Thread() {
+		}
 		bool running;
 		void Start();
+		// waits for Run() to return, only once per Start()
+		void Join();
 		virtual void Run() = 0;
 	};
 #endif	
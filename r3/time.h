@@ -43,9 +43,10 @@
 #ifndef __R3_TIME_H__
 #define __R3_TIME_H__
 
-#if __APPLE__
+#if __APPLE__ || __linux__
 # include <sys/time.h>
 #include <unistd.h>
+#include <time.h>
 #elif _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -55,7 +56,7 @@
 
 namespace r3 {
 
-#if __APPLE__
+#if __APPLE__ || __linux__
 	inline double GetTime() {
 		timeval tv;
 		gettimeofday( &tv, NULL );
@@ -89,7 +90,7 @@ namespace r3 {
 	}
 	
 	inline void SleepMilliseconds( int i ) {
-#ifdef __APPLE__
+#if __APPLE__ || __linux__
 		usleep( i * 1000 );
 #elif _WIN32
 		Sleep( i );
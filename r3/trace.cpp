@@ -0,0 +1,408 @@
+/*
+ *  trace.cpp
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "r3/trace.h"
+
+#include "r3/command.h"
+#include "r3/common.h"
+#include "r3/filesystem.h"
+#include "r3/output.h"
+#include "r3/thread.h"
+#include "r3/var.h"
+
+#ifdef __APPLE__
+# include <libkern/OSAtomic.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace r3;
+
+VarInteger r_traceFrames( "r_traceFrames", "frames recorded by tracecapture when no count is given", 0, 60 );
+VarInteger r_traceEvents( "r_traceEvents", "trace events each thread can hold, read when the thread first traces", 0, 1 << 16 );
+VarString r_traceFile( "r_traceFile", "file written by tracedump when no name is given", 0, "trace.json" );
+
+namespace {
+	
+	enum TraceEventTypeEnum {
+		TraceEvent_Begin,
+		TraceEvent_End,
+		TraceEvent_Frame
+	};
+	
+	struct TraceEvent {
+		const char * name;
+		double time;
+		TraceEventTypeEnum type;
+	};
+	
+	// Only the owning thread writes to a buffer.  It publishes an event by
+	// bumping count after a barrier, and empties itself when it sees a new
+	// capture generation, so neither side takes a lock per event.  A thread
+	// gets one the first time it traces during a capture, and gives it back
+	// when it exits for a later thread to reuse.
+	struct TraceBuffer {
+		TraceEvent * events;
+		int capacity;
+		volatile int count;
+		volatile int dropped;
+		volatile int generation;
+		int tid;
+		const char * threadName;
+		bool owned;  // guarded by buffersMutex
+	};
+	
+	inline void MemoryFence() {
+#ifdef __APPLE__
+		OSMemoryBarrier();
+#elif __linux__
+		__sync_synchronize();
+#elif _WIN32
+		MemoryBarrier();
+#endif
+	}
+	
+#if __APPLE__ || __linux__
+	pthread_key_t bufferKey;
+	pthread_key_t nameKey;
+#elif _WIN32
+	DWORD bufferKey;
+	DWORD nameKey;
+#endif
+	
+	Mutex buffersMutex;
+	vector< TraceBuffer * > buffers;
+	
+	volatile int generation;
+	int pendingFrames;
+	int framesLeft;
+	double captureStart;
+	double captureEnd;
+	
+	void * GetThreadValue( const void * key ) {
+#if __APPLE__ || __linux__
+		return pthread_getspecific( *static_cast< const pthread_key_t * >( key ) );
+#elif _WIN32
+		return TlsGetValue( *static_cast< const DWORD * >( key ) );
+#endif
+	}
+	
+	void SetThreadValue( const void * key, const void * value ) {
+#if __APPLE__ || __linux__
+		pthread_setspecific( *static_cast< const pthread_key_t * >( key ), value );
+#elif _WIN32
+		TlsSetValue( *static_cast< const DWORD * >( key ), const_cast< void * >( value ) );
+#endif
+	}
+	
+	// Buffers are only ever released, so there are no more of them than
+	// threads tracing at once.  A thread taking over a buffer in the same
+	// capture appends after its last owner's events on the same track, so
+	// one with the same name is preferred.
+	TraceBuffer * AcquireBuffer( int gen, const char * name ) {
+		ScopedMutex m( buffersMutex );
+		TraceBuffer * reuse = NULL;
+		for ( int i = 0; i < (int)buffers.size(); i++ ) {
+			TraceBuffer * b = buffers[ i ];
+			if ( b->owned == false && ( reuse == NULL || b->threadName == name ) ) {
+				reuse = b;
+			}
+		}
+		if ( reuse ) {
+			reuse->owned = true;
+			return reuse;
+		}
+		TraceBuffer * b = new TraceBuffer;
+		b->capacity = max( 1024, r_traceEvents.GetVal() );
+		b->events = new TraceEvent[ b->capacity ];
+		b->count = 0;
+		b->dropped = 0;
+		b->generation = gen;
+		b->tid = (int)buffers.size();
+		b->owned = true;
+		buffers.push_back( b );
+		return b;
+	}
+	
+	// NULL when the thread has no buffer and no capture is running
+	TraceBuffer * GetThreadBuffer() {
+		TraceBuffer * b = static_cast< TraceBuffer * >( GetThreadValue( &bufferKey ) );
+		int gen = generation;
+		if ( b == NULL ) {
+			if ( traceCapturing == false ) {
+				return NULL;
+			}
+			const char * name = static_cast< const char * >( GetThreadValue( &nameKey ) );
+			b = AcquireBuffer( gen, name );
+			b->threadName = name;
+			SetThreadValue( &bufferKey, b );
+		}
+		if ( b->generation != gen ) {
+			b->count = 0;
+			b->dropped = 0;
+			MemoryFence();
+			b->generation = gen;
+		}
+		return b;
+	}
+	
+	void Append( const char * name, double time, TraceEventTypeEnum type ) {
+		TraceBuffer * b = GetThreadBuffer();
+		if ( b == NULL ) {
+			return;
+		}
+		int c = b->count;
+		if ( c >= b->capacity ) {
+			b->dropped++;
+			return;
+		}
+		TraceEvent & e = b->events[ c ];
+		e.name = name;
+		e.time = time;
+		e.type = type;
+		MemoryFence();
+		b->count = c + 1;
+	}
+	
+	string JsonString( const char * s ) {
+		string str = "\"";
+		for ( ; *s; s++ ) {
+			if ( *s == '"' || *s == '\\' ) {
+				str += '\\';
+			}
+			str += *s;
+		}
+		return str + "\"";
+	}
+	
+	void WriteEvent( File * f, bool & first, const char * name, char phase, double time, int tid ) {
+		char buf[ 96 ];
+		r3Sprintf( buf, "\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", ( time - captureStart ) * 1000000.0, tid );
+		string line = first ? "" : ",";
+		line += "{\"name\":" + JsonString( name ) + ",\"ph\":\"" + phase + buf;
+		if ( phase == 'i' ) {
+			line += ",\"s\":\"g\"";
+		}
+		f->WriteLine( line + "}" );
+		first = false;
+	}
+	
+	// Writes the last capture as trace event JSON.  Ends without a begin
+	// are dropped, and anything after the last frame is cut off with open
+	// begins closed there, so every slice in the viewer is balanced.
+	bool WriteTrace( const string & filename, int & numEvents, int & numThreads ) {
+		vector< TraceBuffer * > bufs;
+		{
+			ScopedMutex m( buffersMutex );
+			bufs = buffers;
+		}
+		File * f = FileOpenForWrite( filename );
+		if ( f == NULL ) {
+			return false;
+		}
+		numEvents = numThreads = 0;
+		bool first = true;
+		f->WriteLine( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+		for ( int i = 0; i < (int)bufs.size(); i++ ) {
+			TraceBuffer * b = bufs[ i ];
+			if ( b->generation != generation ) {
+				continue;
+			}
+			int count = b->count;
+			MemoryFence();
+			if ( count == 0 ) {
+				continue;
+			}
+			numThreads++;
+			
+			char tname[ 32 ];
+			r3Sprintf( tname, "thread %d", b->tid );
+			char buf[ 64 ];
+			r3Sprintf( buf, ",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", b->tid );
+			f->WriteLine( string( first ? "" : "," ) + "{\"name\":\"thread_name\"" + buf +
+						 JsonString( b->threadName ? b->threadName : tname ) + "}}" );
+			first = false;
+			
+			vector< const char * > open;
+			for ( int j = 0; j < count; j++ ) {
+				const TraceEvent & e = b->events[ j ];
+				if ( e.time > captureEnd ) {
+					break;
+				}
+				switch ( e.type ) {
+					case TraceEvent_Begin:
+						open.push_back( e.name );
+						WriteEvent( f, first, e.name, 'B', e.time, b->tid );
+						break;
+					case TraceEvent_End:
+						if ( open.size() == 0 ) {
+							continue;
+						}
+						WriteEvent( f, first, open.back(), 'E', e.time, b->tid );
+						open.pop_back();
+						break;
+					case TraceEvent_Frame:
+						WriteEvent( f, first, e.name, 'i', e.time, b->tid );
+						break;
+				}
+				numEvents++;
+			}
+			while ( open.size() > 0 ) {
+				WriteEvent( f, first, open.back(), 'E', captureEnd, b->tid );
+				open.pop_back();
+			}
+			if ( b->dropped ) {
+				Output( "trace: thread %d dropped %d events, raise r_traceEvents", b->tid, (int)b->dropped );
+			}
+		}
+		f->WriteLine( "]}" );
+		delete f;
+		return true;
+	}
+	
+	// tracecapture command
+	void TraceCapture( const vector< Token > & tokens ) {
+		if ( traceCapturing || pendingFrames > 0 ) {
+			Output( "A trace capture is already running." );
+			return;
+		}
+		int frames = r_traceFrames.GetVal();
+		if ( tokens.size() > 1 && tokens[1].type == TokenType_Number ) {
+			frames = int( tokens[1].valNumber );
+		}
+		pendingFrames = max( 1, frames );
+		Output( "Tracing the next %d frames.", pendingFrames );
+	}
+	CommandFunc TraceCaptureCmd( "tracecapture", "tracecapture [frames] - records a timeline of the next frames", TraceCapture );
+	
+	// tracedump command
+	void TraceDump( const vector< Token > & tokens ) {
+		if ( traceCapturing || pendingFrames > 0 ) {
+			Output( "The trace capture has not finished yet." );
+			return;
+		}
+		if ( TraceAvailable() == false ) {
+			Output( "Nothing captured, use tracecapture first." );
+			return;
+		}
+		string filename = tokens.size() > 1 ? tokens[1].valString : r_traceFile.GetVal();
+		int numEvents, numThreads;
+		if ( WriteTrace( filename, numEvents, numThreads ) == false ) {
+			Output( "Unable to open %s for writing.", filename.c_str() );
+			return;
+		}
+		Output( "Wrote %d events from %d threads to %s", numEvents, numThreads, filename.c_str() );
+	}
+	CommandFunc TraceDumpCmd( "tracedump", "tracedump [file] - writes the last trace capture as chrome://tracing JSON", TraceDump );
+	
+}
+
+namespace r3 {
+	
+	volatile bool traceCapturing;
+	
+	void InitTrace() {
+#if __APPLE__ || __linux__
+		pthread_key_create( &bufferKey, NULL );
+		pthread_key_create( &nameKey, NULL );
+#elif _WIN32
+		bufferKey = TlsAlloc();
+		nameKey = TlsAlloc();
+#endif
+		TraceThreadName( "main" );
+	}
+	
+	void TraceBegin( const char * name, double time ) {
+		Append( name, time, TraceEvent_Begin );
+	}
+	
+	void TraceEnd( const char * name, double time ) {
+		Append( name, time, TraceEvent_End );
+	}
+	
+	void TraceThreadName( const char * name ) {
+		SetThreadValue( &nameKey, name );
+		TraceBuffer * b = static_cast< TraceBuffer * >( GetThreadValue( &bufferKey ) );
+		if ( b ) {
+			b->threadName = name;
+		}
+	}
+	
+	void TraceThreadExit() {
+		TraceBuffer * b = static_cast< TraceBuffer * >( GetThreadValue( &bufferKey ) );
+		if ( b ) {
+			SetThreadValue( &bufferKey, NULL );
+			ScopedMutex m( buffersMutex );
+			b->owned = false;
+		}
+		SetThreadValue( &nameKey, NULL );
+	}
+	
+	bool TraceAvailable() {
+		return generation > 0 && traceCapturing == false && pendingFrames == 0;
+	}
+	
+	void TraceFrame() {
+		if ( traceCapturing ) {
+			double now = GetTime();
+			Append( "frame", now, TraceEvent_Frame );
+			if ( --framesLeft <= 0 ) {
+				captureEnd = now;
+				traceCapturing = false;
+				Output( "Trace capture finished, tracedump writes it out." );
+			}
+		} else if ( pendingFrames > 0 ) {
+			framesLeft = pendingFrames;
+			pendingFrames = 0;
+			generation++;
+			captureStart = GetTime();
+			MemoryFence();
+			traceCapturing = true;
+			Append( "frame", captureStart, TraceEvent_Frame );
+		}
+	}
+	
+}
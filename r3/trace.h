@@ -0,0 +1,93 @@
+/*
+ *  trace.h
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __R3_TRACE_H__
+#define __R3_TRACE_H__
+
+#include "r3/time.h"
+
+namespace r3 {
+	
+	// Timeline capture for chrome://tracing.  "tracecapture [frames]"
+	// records begin/end events from every thread for that many frames,
+	// "tracedump [file]" writes them out as trace event JSON.  Each thread
+	// appends to its own fixed size buffer without locking, so names must
+	// be string literals or otherwise outlive the capture.
+	void InitTrace();
+	
+	extern volatile bool traceCapturing;
+	
+	inline bool Tracing() {
+		return traceCapturing;
+	}
+	
+	void TraceBegin( const char * name, double time );
+	void TraceEnd( const char * name, double time );
+	// names the calling thread's track in the trace
+	void TraceThreadName( const char * name );
+	// gives the calling thread's buffer back for reuse, as r3 threads exit
+	void TraceThreadExit();
+	// Called by ProfileFrame(), starts and stops captures on frame boundaries.
+	void TraceFrame();
+	// true once a capture has finished
+	bool TraceAvailable();
+	
+	class TraceScope {
+	public:
+		TraceScope( const char * scopeName ) : name( Tracing() ? scopeName : NULL ) {
+			if ( name ) {
+				TraceBegin( name, GetTime() );
+			}
+		}
+		~TraceScope() {
+			if ( name ) {
+				TraceEnd( name, GetTime() );
+			}
+		}
+	private:
+		const char * name;
+	};
+	
+}
+
+#endif // __R3_TRACE_H__
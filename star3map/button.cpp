@@ -52,7 +52,7 @@ using namespace std;
 namespace star3map {
     Button::Button( const std::string & bTextureFilename ) 
 	: tex( NULL ), inputOver( false ), color( 1, 1, 1, 1 )  {
-        tex = CreateTexture2DFromFile( bTextureFilename, TextureFormat_RGBA );
+        tex = CreateTexture2DFromFileAsync( bTextureFilename, TextureFormat_RGBA );
         bounds.Min() = Vec2f( 0, 0 );
         bounds.Max() = Vec2f( (float)tex->Width(), (float)tex->Height() );
     }
@@ -0,0 +1,258 @@
+/*
+ *  constellationgrid
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#include "constellationgrid.h"
+
+#include "r3/filesystem.h"
+#include "r3/output.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+using namespace std;
+using namespace r3;
+
+namespace {
+    const int ConstellationGridMagic = 0x43475244; // "CGRD"
+    const int ConstellationGridVersion = 2;
+    const uchar NoConstellation = 255;
+    // cones move with the star epoch after the grid is built
+    const float ConeSlack = 1.0f * R3_PI / 180.0f;
+    
+    float Longitude( const Vec3f & d ) {
+        float l = atan2( d.y, d.x );
+        return l < 0 ? l + 2.0f * R3_PI : l;
+    }
+    
+    Vec3f GridDirection( float z, float lon ) {
+        float r = sqrt( max( 0.0f, 1.0f - z * z ) );
+        return Vec3f( r * cos( lon ), r * sin( lon ), z );
+    }
+    
+    float Angle( const Vec3f & a, const Vec3f & b ) {
+        return acos( max( -1.0f, min( 1.0f, a.Dot( b ) ) ) );
+    }
+}
+
+namespace star3map {
+    
+    ConstellationGrid::ConstellationGrid() : bands( 128 ), sectors( 256 ) {
+    }
+    
+    void ConstellationGrid::Build( const vector< Lines > & constellations ) {
+        vector< Vec3f > vert;
+        vector< uchar > owner;
+        for ( int i = 0; i < (int)constellations.size() && i < NoConstellation; i++ ) {
+            const Lines & l = constellations[i];
+            for ( int j = 0; j < (int)l.vert.size(); j++ ) {
+                vert.push_back( l.vert[j] );
+                owner.push_back( uchar( i ) );
+            }
+        }
+        cell.assign( bands * sectors, NoConstellation );
+        coneCount.assign( bands * sectors, 0 );
+        cone.clear();
+        if ( vert.size() == 0 ) {
+            IndexCones();
+            return;
+        }
+        float sectorSize = 2.0f * R3_PI / sectors;
+        for ( int b = 0; b < bands; b++ ) {
+            float z0 = b * 2.0f / bands - 1.0f;
+            float z1 = ( b + 1 ) * 2.0f / bands - 1.0f;
+            float z = ( b + 0.5f ) * 2.0f / bands - 1.0f;
+            for ( int s = 0; s < sectors; s++ ) {
+                float lon = ( s + 0.5f ) * sectorSize;
+                Vec3f d = GridDirection( z, lon );
+                float best = -2.0f;
+                for ( int i = 0; i < (int)vert.size(); i++ ) {
+                    float dot = d.Dot( vert[i] );
+                    if ( dot > best ) {
+                        best = dot;
+                        cell[ b * sectors + s ] = owner[i];
+                    }
+                }
+                
+                // a cone overlaps the cell if it comes within the cell's
+                // reach from its center, the farthest corner
+                float reach = 0.0f;
+                for ( int k = 0; k < 4; k++ ) {
+                    Vec3f corner = GridDirection( ( k & 1 ) ? z1 : z0, ( s + ( k >> 1 ) ) * sectorSize );
+                    reach = max( reach, Angle( d, corner ) );
+                }
+                for ( int i = 0; i < (int)constellations.size() && i < NoConstellation; i++ ) {
+                    const Lines & l = constellations[i];
+                    if ( l.vert.size() == 0 ) {
+                        continue;
+                    }
+                    float radius = acos( max( -1.0f, min( 1.0f, l.limit ) ) );
+                    if ( Angle( d, l.center ) <= radius + reach + ConeSlack ) {
+                        cone.push_back( uchar( i ) );
+                        coneCount[ b * sectors + s ]++;
+                    }
+                }
+            }
+        }
+        IndexCones();
+    }
+    
+    void ConstellationGrid::IndexCones() {
+        coneStart.resize( coneCount.size() );
+        int start = 0;
+        for ( int i = 0; i < (int)coneCount.size(); i++ ) {
+            coneStart[i] = start;
+            start += coneCount[i];
+        }
+    }
+    
+    bool ConstellationGrid::Write( const string & filename, int signature ) const {
+        if ( cell.size() == 0 || coneCount.size() != cell.size() ) {
+            return false;
+        }
+        File * f = FileOpenForWrite( filename );
+        if ( f == NULL ) {
+            return false;
+        }
+        int header[6] = { ConstellationGridMagic, ConstellationGridVersion, signature, bands, sectors, (int)cone.size() };
+        f->Write( header, sizeof( int ), 6 );
+        f->Write( &cell[0], 1, (int)cell.size() );
+        f->Write( &coneCount[0], 1, (int)coneCount.size() );
+        if ( cone.size() > 0 ) {
+            f->Write( &cone[0], 1, (int)cone.size() );
+        }
+        delete f;
+        return true;
+    }
+    
+    bool ConstellationGrid::Read( const string & filename, int signature ) {
+        vector< uchar > data;
+        if ( FileReadToMemory( filename, data ) == false ) {
+            return false;
+        }
+        int header[6];
+        if ( data.size() < sizeof( header ) ) {
+            return false;
+        }
+        memcpy( header, &data[0], sizeof( header ) );
+        int cells = header[3] * header[4];
+        if ( header[0] != ConstellationGridMagic || header[1] != ConstellationGridVersion || header[2] != signature ||
+             header[3] <= 0 || header[4] <= 0 || header[5] < 0 || data.size() != sizeof( header ) + 2 * cells + header[5] ) {
+            Output( "Ignoring stale or invalid constellation grid %s", filename.c_str() );
+            return false;
+        }
+        bands = header[3];
+        sectors = header[4];
+        vector< uchar >::iterator it = data.begin() + sizeof( header );
+        cell.assign( it, it + cells );
+        coneCount.assign( it + cells, it + 2 * cells );
+        cone.assign( it + 2 * cells, data.end() );
+        IndexCones();
+        int total = 0;
+        for ( int i = 0; i < cells; i++ ) {
+            total += coneCount[i];
+        }
+        if ( total != (int)cone.size() ) {
+            Output( "Ignoring stale or invalid constellation grid %s", filename.c_str() );
+            cell.clear();
+            coneCount.clear();
+            coneStart.clear();
+            cone.clear();
+            return false;
+        }
+        return true;
+    }
+    
+    int ConstellationGrid::Lookup( const Vec3f & dir ) const {
+        if ( cell.size() == 0 ) {
+            return -1;
+        }
+        int b = int( ( dir.z + 1.0f ) * 0.5f * bands );
+        int s = int( Longitude( dir ) * sectors / ( 2.0f * R3_PI ) );
+        b = max( 0, min( bands - 1, b ) );
+        s = max( 0, min( sectors - 1, s ) );
+        uchar c = cell[ b * sectors + s ];
+        return c == NoConstellation ? -1 : c;
+    }
+    
+    void ConstellationGrid::Query( const Vec3f & dir, float radius, vector< int > & results ) const {
+        if ( coneCount.size() == 0 ) {
+            return;
+        }
+        float lat = asin( max( -1.0f, min( 1.0f, dir.z ) ) );
+        float latLo = max( -R3_PI * 0.5f, lat - radius );
+        float latHi = min( R3_PI * 0.5f, lat + radius );
+        int b0 = max( 0, int( ( sin( latLo ) + 1.0f ) * 0.5f * bands ) );
+        int b1 = min( bands - 1, int( ( sin( latHi ) + 1.0f ) * 0.5f * bands ) );
+        
+        int s0 = 0;
+        int s1 = sectors - 1;
+        float maxLat = max( fabs( latLo ), fabs( latHi ) );
+        float ratio = maxLat < R3_PI * 0.5f ? sin( radius ) / cos( maxLat ) : 1.0f;
+        if ( ratio < 1.0f ) {
+            float span = asin( ratio );
+            float sectorSize = 2.0f * R3_PI / sectors;
+            float lon = Longitude( dir );
+            s0 = int( floor( ( lon - span ) / sectorSize ) );
+            s1 = int( floor( ( lon + span ) / sectorSize ) );
+            if ( s1 - s0 >= sectors ) {
+                s0 = 0;
+                s1 = sectors - 1;
+            }
+        }
+        
+        bool seen[ 256 ] = { false };
+        for ( int b = b0; b <= b1; b++ ) {
+            for ( int s = s0; s <= s1; s++ ) {
+                int i = b * sectors + ( ( s % sectors ) + sectors ) % sectors;
+                for ( int k = 0; k < coneCount[i]; k++ ) {
+                    uchar c = cone[ coneStart[i] + k ];
+                    if ( seen[ c ] == false ) {
+                        seen[ c ] = true;
+                        results.push_back( c );
+                    }
+                }
+            }
+        }
+    }
+    
+}
@@ -0,0 +1,97 @@
+/*
+ *  constellationgrid
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#ifndef __STAR3MAP_CONSTELLATIONGRID_H__
+#define __STAR3MAP_CONSTELLATIONGRID_H__
+
+#include "render.h"
+#include "r3/common.h"
+#include "r3/linear.h"
+
+#include <string>
+#include <vector>
+
+namespace star3map {
+	
+    // Equal-area ( uniform in z and longitude ) grid over the sky that
+    // stores the index of the constellation owning each cell, and the
+    // constellations whose bounding cones reach into each cell.
+    class ConstellationGrid {
+    public:
+        ConstellationGrid();
+        
+        // Assigns each cell to the constellation with the nearest figure
+        // vertex, and lists in it every ( center, limit ) cone it overlaps.
+        void Build( const std::vector< Lines > & constellations );
+        
+        bool Write( const std::string & filename, int signature ) const;
+        bool Read( const std::string & filename, int signature );
+        
+        bool Valid() const {
+            return cell.size() > 0;
+        }
+        int Bytes() const {
+            return (int)( cell.capacity() + coneCount.capacity() + coneStart.capacity() * sizeof( int ) + cone.capacity() );
+        }
+        
+        // Returns the constellation containing dir, or -1.
+        int Lookup( const r3::Vec3f & dir ) const;
+        
+        // Appends each distinct constellation whose cone reaches a cell
+        // within radius (radians) of dir.  Any constellation whose cone
+        // contains dir is among them.
+        void Query( const r3::Vec3f & dir, float radius, std::vector< int > & results ) const;
+        
+    private:
+        int bands;
+        int sectors;
+        std::vector< r3::uchar > cell;   // 255 for no constellation
+        std::vector< r3::uchar > coneCount;
+        std::vector< int > coneStart;    // into cone, per cell
+        std::vector< r3::uchar > cone;
+        
+        void IndexCones();
+    };
+    
+}
+
+#endif //__STAR3MAP_CONSTELLATIONGRID_H__
@@ -0,0 +1,189 @@
+/*
+ *  nameindex
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#include "nameindex.h"
+
+#include "r3/common.h"
+#include "r3/filesystem.h"
+#include "r3/output.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace r3;
+
+namespace {
+    const int NameIndexMagic = 0x4e494458; // "NIDX"
+    const int NameIndexVersion = 1;
+    
+    void WriteInt( File * f, int i ) {
+        f->Write( &i, sizeof( i ), 1 );
+    }
+    
+    bool ReadInt( File * f, int & i ) {
+        return f->Read( &i, sizeof( i ), 1 ) == 1;
+    }
+    
+    void WriteString( File * f, const string & s ) {
+        WriteInt( f, (int)s.size() );
+        if ( s.size() ) {
+            f->Write( s.c_str(), 1, (int)s.size() );
+        }
+    }
+    
+    bool ReadString( File * f, string & s ) {
+        int len;
+        if ( ReadInt( f, len ) == false || len < 0 || len > 1024 ) {
+            return false;
+        }
+        s.resize( len );
+        return len == 0 || f->Read( &s[0], 1, len ) == len;
+    }
+}
+
+namespace star3map {
+    
+    void NameIndex::Clear() {
+        entries.clear();
+    }
+    
+    int NameIndex::Bytes() const {
+        int bytes = (int)( entries.capacity() * sizeof( Entry ) );
+        for ( int i = 0; i < (int)entries.size(); i++ ) {
+            bytes += (int)( entries[i].key.capacity() + entries[i].name.capacity() );
+        }
+        return bytes;
+    }
+    
+    void NameIndex::Add( const string & name, const ObjectHandle & handle ) {
+        if ( name.size() == 0 ) {
+            return;
+        }
+        Entry e;
+        e.key = LowerCase( name );
+        e.name = name;
+        e.handle = handle;
+        entries.push_back( e );
+    }
+    
+    void NameIndex::Finalize() {
+        sort( entries.begin(), entries.end() );
+    }
+    
+    int NameIndex::Find( const string & prefix, vector< const Entry * > & results, int maxResults ) const {
+        Entry probe;
+        probe.key = LowerCase( prefix );
+        int len = (int)probe.key.size();
+        int found = 0;
+        vector< Entry >::const_iterator it = lower_bound( entries.begin(), entries.end(), probe );
+        for ( ; it != entries.end() && found < maxResults; ++it ) {
+            if ( it->key.compare( 0, len, probe.key ) != 0 ) {
+                break;
+            }
+            bool duplicate = false;
+            for ( int i = (int)results.size() - found; i < (int)results.size(); i++ ) {
+                if ( results[i]->handle == it->handle ) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if ( duplicate == false ) {
+                results.push_back( & (*it) );
+                found++;
+            }
+        }
+        return found;
+    }
+    
+    bool NameIndex::Write( const string & filename, int signature ) const {
+        File * f = FileOpenForWrite( filename );
+        if ( f == NULL ) {
+            return false;
+        }
+        WriteInt( f, NameIndexMagic );
+        WriteInt( f, NameIndexVersion );
+        WriteInt( f, signature );
+        WriteInt( f, (int)entries.size() );
+        for ( int i = 0; i < (int)entries.size(); i++ ) {
+            const Entry & e = entries[i];
+            WriteInt( f, (int)e.handle.type );
+            WriteInt( f, e.handle.index );
+            WriteString( f, e.name );
+        }
+        delete f;
+        return true;
+    }
+    
+    bool NameIndex::Read( const string & filename, int signature ) {
+        File * f = FileOpenForRead( filename );
+        if ( f == NULL ) {
+            return false;
+        }
+        int magic = 0, version = 0, sig = 0, count = 0;
+        bool ok = ReadInt( f, magic ) && magic == NameIndexMagic &&
+                  ReadInt( f, version ) && version == NameIndexVersion &&
+                  ReadInt( f, sig ) && sig == signature &&
+                  ReadInt( f, count ) && count >= 0;
+        vector< Entry > loaded;
+        if ( ok ) {
+            loaded.resize( count );
+        }
+        for ( int i = 0; ok && i < count; i++ ) {
+            Entry & e = loaded[i];
+            int type;
+            ok = ReadInt( f, type ) && type > ObjectType_Invalid && type < ObjectType_MAX &&
+                 ReadInt( f, e.handle.index ) &&
+                 ReadString( f, e.name );
+            e.handle.type = (ObjectTypeEnum)type;
+            e.key = LowerCase( e.name );
+        }
+        delete f;
+        if ( ok == false ) {
+            Output( "Ignoring stale or invalid name index %s", filename.c_str() );
+            return false;
+        }
+        // entries were written sorted
+        entries.swap( loaded );
+        return true;
+    }
+    
+}
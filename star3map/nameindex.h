@@ -0,0 +1,112 @@
+/*
+ *  nameindex
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#ifndef __STAR3MAP_NAMEINDEX_H__
+#define __STAR3MAP_NAMEINDEX_H__
+
+#include <string>
+#include <vector>
+
+namespace star3map {
+	
+    enum ObjectTypeEnum {
+        ObjectType_Invalid,
+        ObjectType_Star,          // index into stars
+        ObjectType_SolarSystem,   // index into solarsystem
+        ObjectType_Constellation, // index into constellations
+        ObjectType_Satellite,     // index into the satellite list
+        ObjectType_MAX
+    };
+    
+    struct ObjectHandle {
+        ObjectHandle() : type( ObjectType_Invalid ), index( -1 ) {}
+        ObjectHandle( ObjectTypeEnum oType, int oIndex ) : type( oType ), index( oIndex ) {}
+        ObjectTypeEnum type;
+        int index;
+        bool operator == ( const ObjectHandle & rhs ) const {
+            return type == rhs.type && index == rhs.index;
+        }
+    };
+    
+    // Sorted string table for prefix search over object names.  Keys are
+    // stored lower case, so lookups are case insensitive.
+    class NameIndex {
+    public:
+        struct Entry {
+            std::string key;
+            std::string name;
+            ObjectHandle handle;
+            bool operator < ( const Entry & rhs ) const {
+                return key < rhs.key;
+            }
+        };
+        
+        void Clear();
+        void Add( const std::string & name, const ObjectHandle & handle );
+        // sorts the table, call after the last Add()
+        void Finalize();
+        
+        int Size() const {
+            return (int)entries.size();
+        }
+        // approximate, counts string capacity but not allocator overhead
+        int Bytes() const;
+        const Entry & GetEntry( int i ) const {
+            return entries[ i ];
+        }
+        
+        // Appends up to maxResults distinct entries whose key starts with
+        // prefix, in key order.  Returns the number of entries appended.
+        int Find( const std::string & prefix, std::vector< const Entry * > & results, int maxResults = 16 ) const;
+        
+        // The signature identifies the catalogs the index was built from, so a
+        // cached index can be rejected when they change.
+        bool Write( const std::string & filename, int signature ) const;
+        bool Read( const std::string & filename, int signature );
+        
+    private:
+        std::vector< Entry > entries;
+    };
+    
+}
+
+#endif //__STAR3MAP_NAMEINDEX_H__
@@ -46,8 +46,13 @@
 #include "r3/font.h"
 #include "r3/gl.h"
 #include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/renderlist.h"
 #include "r3/var.h"
 
+#include <map>
+#include <string.h>
+
 using namespace r3;
 using namespace std;
 
@@ -58,18 +63,73 @@ VarFloat app_fontScale( "app_fontScale", "main app font rendering scale", Var_Ar
 VarFloat app_starScale( "app_starScale", "scale of star sprite rendering", Var_Archive, 2 );
 VarFloat app_scale( "app_scale", "scale of stuff in angle space", Var_Archive, 0.0001f );
 
+VarInteger app_stringMetricsHits( "app_stringMetricsHits", "string metrics cache hits", Var_ReadOnly, 0 );
+VarInteger app_stringMetricsMisses( "app_stringMetricsMisses", "string metrics cache misses", Var_ReadOnly, 0 );
+VarInteger app_rotateToHits( "app_rotateToHits", "label orientation cache hits", Var_ReadOnly, 0 );
+VarInteger app_rotateToMisses( "app_rotateToMisses", "label orientation cache misses", Var_ReadOnly, 0 );
+
 using namespace star3map;
 
 extern VarFloat r_fov;
 
 namespace {
 	
+    ProfileTimer spriteTimer( "drawSprites" );
+    
     Font *font;
     float fov;
     float fovFontScale;
     
     int transformVersion = 0;
     vector< Matrix4f > transformStack;
+    
+    Vec4f currentColor( 1, 1, 1, 1 );
+    
+    // billboards queued by DrawSprite, already expanded to the
+    // corners of the quad in the current object space
+    struct SpriteVertex {
+        float pos[3];
+        uchar color[4];
+        float st[2];
+    };
+    RenderList *spriteList;
+    
+    // string extents, which only depend on the string and the scale
+    struct StringMetricsKey {
+        Font *font;
+        string str;
+        float scale;
+        bool operator < ( const StringMetricsKey & rhs ) const {
+            if ( font != rhs.font ) {
+                return font < rhs.font;
+            }
+            if ( scale != rhs.scale ) {
+                return scale < rhs.scale;
+            }
+            return str < rhs.str;
+        }
+    };
+    map< StringMetricsKey, Bounds2f > stringMetrics;
+    
+    // direct mapped cache of RotateTo() results, labels and sprites for
+    // the same direction and up vector share one matrix
+    struct RotateToEntry {
+        RotateToEntry() : valid( false ) {}
+        Vec3f direction;
+        Vec3f up;
+        Matrix4f m;
+        bool valid;
+    };
+    RotateToEntry rotateToCache[ 256 ];
+    
+    uint HashFloats( const float *f, int count, uint h ) {
+        for ( int i = 0; i < count; i++ ) {
+            uint u;
+            memcpy( &u, f + i, sizeof( u ) );
+            h = ( h ^ u ) * 16777619u;
+        }
+        return h;
+    }
 
 }
 
@@ -93,15 +153,59 @@ namespace star3map {
     
     Vec3f UpVector;
     
+    Matrix4f CachedRotateTo( const Vec3f & direction ) {
+        uint h = HashFloats( & direction.x, 3, 2166136261u );
+        h = HashFloats( & UpVector.x, 3, h );
+        RotateToEntry & e = rotateToCache[ ( h ^ ( h >> 16 ) ) & 255 ];
+        if ( e.valid && e.direction == direction && e.up == UpVector ) {
+            app_rotateToHits.SetVal( app_rotateToHits.GetVal() + 1 );
+            return e.m;
+        }
+        app_rotateToMisses.SetVal( app_rotateToMisses.GetVal() + 1 );
+        e.direction = direction;
+        e.up = UpVector;
+        e.m = RotateTo( direction );
+        e.valid = true;
+        return e.m;
+    }
+    
+    Bounds2f GetStringMetrics( Font *f, const std::string & str, float scale ) {
+        StringMetricsKey key;
+        key.font = f;
+        key.str = str;
+        key.scale = scale;
+        map< StringMetricsKey, Bounds2f >::iterator it = stringMetrics.find( key );
+        if ( it != stringMetrics.end() ) {
+            app_stringMetricsHits.SetVal( app_stringMetricsHits.GetVal() + 1 );
+            return it->second;
+        }
+        app_stringMetricsMisses.SetVal( app_stringMetricsMisses.GetVal() + 1 );
+        if ( stringMetrics.size() >= 1024 ) {
+            stringMetrics.clear(); // fov changes generate new scales
+        }
+        Bounds2f b = f->GetStringDimensions( str, scale );
+        stringMetrics[ key ] = b;
+        return b;
+    }
+    
     void Clear() {
-        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        ClearFramebuffer();
     }
 	
     void SetColor( const Vec4f & c ) {
         //Output( "SetColor( %.2f, %.2f, %.2f, %.2f )", c.x, c.y, c.z, c.w );
+        currentColor = c;
         ImColorf( c.x, c.y, c.z, c.w );
     }
     
+    // Draw all queued sprites, sorted and merged by texture.
+    void FlushSprites() {
+        ProfileScope ps( spriteTimer );
+        if ( spriteList ) {
+            spriteList->Submit();
+        }
+    }
+    
     void PushTransform() {
         if ( transformStack.size() > 0 ) {
             transformStack.push_back( transformStack.back() );			
@@ -109,28 +213,28 @@ namespace star3map {
             transformStack.push_back( Matrix4f() );
             transformStack.back().MakeIdentity();
         }
-        glPushMatrix();
+        MatrixPush();
     }
 	
     void ClearTransform() {
         transformVersion++;
         assert( transformStack.size() > 0 );
         transformStack.back().MakeIdentity();
-        glLoadIdentity();
+        MatrixLoadIdentity();
     }
 	
     void PopTransform() {
         transformVersion++;
         assert( transformStack.size() > 0 );
         transformStack.pop_back();
-        glPopMatrix();
+        MatrixPop();
     }
     
     void ApplyTransform( const r3::Matrix4f &m ) {
         transformVersion++;
         assert( transformStack.size() > 0 );
         transformStack.back() = transformStack.back() * m;
-        glMultMatrixf( m.Ptr() );	
+        MatrixMult( m );	
     }
     
     Matrix4f GetTransform() {
@@ -139,16 +243,18 @@ namespace star3map {
     }
     
     void DrawQuad( float radius, const Vec3f & direction ) {
-        Matrix4f m = RotateTo( direction );
-        glPushMatrix();
-        glMultMatrixf( m.Ptr() );
-        glScalef( radius * app_scale.GetVal(), radius * app_scale.GetVal(), 1.f );
-        glTranslatef( 0, 0, -1 );
+        FlushSprites();
+        Matrix4f m = CachedRotateTo( direction );
+        MatrixPush();
+        MatrixMult( m );
+        MatrixScale( radius * app_scale.GetVal(), radius * app_scale.GetVal(), 1.f );
+        MatrixTranslate( 0, 0, -1 );
         r3::DrawQuad( -10, -10, 10, 10 );
-        glPopMatrix();
+        MatrixPop();
     }
     
     void DrawSprite( Texture2D *tex, r3::Bounds2f bounds ) {
+        FlushSprites();
         tex->Bind( 0 );
         tex->Enable();
         r3::DrawSprite( bounds.Min().x, bounds.Min().y, bounds.Max().x, bounds.Max().y );
@@ -159,16 +265,31 @@ namespace star3map {
         // beef up the width and height since the texture will make it
         // effectively smaller
         radius *= app_starScale.GetVal();
-        Matrix4f m = RotateTo( direction );
-        glPushMatrix();
-        glMultMatrixf( m.Ptr() );
-        glScalef( radius * app_scale.GetVal(), radius * app_scale.GetVal(), 1.f );
-        glTranslatef( 0, 0, -1 );
-        tex->Bind( 0 );
-        tex->Enable();
-        r3::DrawSprite( -10, -10, 10, 10 );
-        tex->Disable();
-        glPopMatrix();
+        float s = 10.0f * radius * app_scale.GetVal();
+        Matrix4f m = CachedRotateTo( direction );
+        static const float corner[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        SpriteVertex v[4];
+        for ( int i = 0; i < 4; i++ ) {
+            Vec3f p = m * Vec3f( corner[i][0] * s, corner[i][1] * s, -1 );
+            v[i].pos[0] = p.x;
+            v[i].pos[1] = p.y;
+            v[i].pos[2] = p.z;
+            for ( int j = 0; j < 4; j++ ) {
+                v[i].color[j] = uchar( currentColor[j] * 255 );
+            }
+            v[i].st[0] = corner[i][0] * 0.5f + 0.5f;
+            v[i].st[1] = corner[i][1] * 0.5f + 0.5f;
+        }
+        if ( spriteList == NULL ) {
+            spriteList = new RenderList( "sprites" );
+        }
+        RenderState rs;
+        rs.tex = tex;
+        rs.blend = true;
+        rs.blendSrc = BlendFunc_SrcAlpha;
+        rs.blendDst = BlendFunc_OneMinusSrcAlpha;
+        spriteList->Add( rs, GetTransform(), currentColor, Primitive_Quads,
+                         Varying_ColorBit | Varying_TexCoord0Bit, v, 4 );
     }
     
     void InitAndUpdate() {
@@ -187,9 +308,9 @@ namespace star3map {
 	
     OrientedBounds2f StringBounds( const std::string & s, const Vec3f & direction ) {
         InitAndUpdate();
-        Bounds2f b = font->GetStringDimensions( s, fovFontScale );
+        Bounds2f b = GetStringMetrics( font, s, fovFontScale );
 	
-        Matrix4f m = RotateTo( direction );
+        Matrix4f m = CachedRotateTo( direction );
         Matrix4f mt;
         mt.SetScale( app_scale.GetVal() );
         mt.SetTranslate( Vec3f( 0, 0, -1 ) );
@@ -215,30 +336,32 @@ namespace star3map {
     }
     
     void DrawString( const std::string & s, const Vec3f & direction ) {
+        FlushSprites();
         InitAndUpdate();
-        Bounds2f b = font->GetStringDimensions( s, fovFontScale );
+        Bounds2f b = GetStringMetrics( font, s, fovFontScale );
 		
-        Matrix4f m = RotateTo( direction );
-        glPushMatrix();
-        glMultMatrixf( m.Ptr() );
-        glScalef( app_scale.GetVal(), app_scale.GetVal(), 1.f );
-        glTranslatef( 0, 0, -1 );
+        Matrix4f m = CachedRotateTo( direction );
+        MatrixPush();
+        MatrixMult( m );
+        MatrixScale( app_scale.GetVal(), app_scale.GetVal(), 1.f );
+        MatrixTranslate( 0, 0, -1 );
         font->Print( s, -b.Width() / 2.f, -1.5f * b.Height(), (float)fovFontScale );
-        glPopMatrix();
+        MatrixPop();
     }
     
     void DrawStringAtLocation( const std::string & s, const Vec3f & position, const Matrix4f & rotation ) {
+        FlushSprites();
         InitAndUpdate();
-        Bounds2f b = font->GetStringDimensions( s, 20.0f );
+        Bounds2f b = GetStringMetrics( font, s, 20.0f );
 	
 		
-        glPushMatrix();
-        glTranslatef( position.x, position.y, position.z );
-        glMultMatrixf( rotation.Ptr() );
+        MatrixPush();
+        MatrixTranslate( position.x, position.y, position.z );
+        MatrixMult( rotation );
         float sc = app_scale.GetVal();
-        glScalef( sc, sc, 1.f );
+        MatrixScale( sc, sc, 1.f );
         font->Print( s, -b.Width() / 2.f, -1.5f * b.Height(), 20.0f );
-        glPopMatrix();
+        MatrixPop();
     }
     
     void DrawDebugGrid() {
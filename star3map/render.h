@@ -69,6 +69,9 @@ namespace star3map {
     struct Lines {
         std::string name;
         std::vector< r3::Vec3f > vert;
+        std::vector< int > star; // index into the star list for each vert
+        int first;               // range of vert in the constellation vertex buffer
+        int count;
         r3::Vec3f center;
         float limit;
     };
@@ -87,7 +90,10 @@ namespace star3map {
     
     void DrawSprite( r3::Texture2D *tex, r3::Bounds2f bounds );
     
+    // Queued with the current transform and drawn, sorted by texture, by
+    // FlushSprites(), which also happens automatically when text is drawn.
     void DrawSprite( r3::Texture2D *tex, float radius, const r3::Vec3f & direction ); 
+    void FlushSprites();
     
     r3::OrientedBounds2f StringBounds( const std::string & str, const r3::Vec3f & direction );
     
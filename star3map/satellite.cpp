@@ -51,11 +51,14 @@
 #include "r3/linear.h"
 #include "r3/output.h"
 #include "r3/time.h"
+#include "r3/var.h"
 
 using namespace std;
 using namespace star3map;
 using namespace r3;
 
+extern VarFloat t_bias;
+
 namespace {
     const double MinutesPerDay = 1440.0; 
     const double SecondsPerDay = 86400.0;
@@ -98,7 +101,8 @@ namespace {
 namespace star3map {
 
     double GetMinutesFromEpoch() {
-        return  ( double( GetTime() ) / 60.0 ) - epochMinutes;
+        // t_bias moves the sky along with the planets
+        return  ( double( GetTime() ) / 60.0 ) + t_bias.GetVal() * 60.0 - epochMinutes;
     }
     
     double GetJulianDate() {
@@ -0,0 +1,142 @@
+/*
+ *  skyindex
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#include "skyindex.h"
+
+#include "r3/common.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace r3;
+
+namespace {
+    
+    float Latitude( const Vec3f & d ) {
+        return asin( max( -1.0f, min( 1.0f, d.z ) ) );
+    }
+    
+    float Longitude( const Vec3f & d ) {
+        float l = atan2( d.y, d.x );
+        return l < 0 ? l + 2.0f * R3_PI : l;
+    }
+    
+}
+
+namespace star3map {
+    
+    SkyIndex::SkyIndex() : bands( 90 ), sectors( 180 ) {
+    }
+    
+    int SkyIndex::Cell( const Vec3f & dir ) const {
+        int b = int( ( Latitude( dir ) + R3_PI * 0.5f ) * bands / R3_PI );
+        int s = int( Longitude( dir ) * sectors / ( 2.0f * R3_PI ) );
+        b = max( 0, min( bands - 1, b ) );
+        s = max( 0, min( sectors - 1, s ) );
+        return b * sectors + s;
+    }
+    
+    void SkyIndex::Build( const vector< Vec3f > & directions ) {
+        direction = directions;
+        int n = (int)direction.size();
+        vector< int > cell( n );
+        cellStart.assign( bands * sectors + 1, 0 );
+        for ( int i = 0; i < n; i++ ) {
+            cell[i] = Cell( direction[i] );
+            cellStart[ cell[i] + 1 ]++;
+        }
+        for ( int i = 0; i < bands * sectors; i++ ) {
+            cellStart[ i + 1 ] += cellStart[ i ];
+        }
+        item.resize( n );
+        vector< int > fill( cellStart.begin(), cellStart.end() - 1 );
+        for ( int i = 0; i < n; i++ ) {
+            item[ fill[ cell[i] ]++ ] = i;
+        }
+    }
+    
+    int SkyIndex::Query( const Vec3f & dir, float radius, vector< int > & results ) const {
+        if ( direction.size() == 0 ) {
+            return 0;
+        }
+        float minDot = cos( radius );
+        float lat = Latitude( dir );
+        float lon = Longitude( dir );
+        float bandSize = R3_PI / bands;
+        float sectorSize = 2.0f * R3_PI / sectors;
+        float latLo = lat - radius;
+        float latHi = lat + radius;
+        int b0 = max( 0, int( ( latLo + R3_PI * 0.5f ) / bandSize ) );
+        int b1 = min( bands - 1, int( ( latHi + R3_PI * 0.5f ) / bandSize ) );
+        
+        // the longitude span of the cone widens with latitude
+        int s0 = 0;
+        int s1 = sectors - 1;
+        float maxLat = max( fabs( latLo ), fabs( latHi ) );
+        float ratio = maxLat < R3_PI * 0.5f ? sin( radius ) / cos( maxLat ) : 1.0f;
+        if ( ratio < 1.0f ) {
+            float span = asin( ratio );
+            s0 = int( floor( ( lon - span ) / sectorSize ) );
+            s1 = int( floor( ( lon + span ) / sectorSize ) );
+            if ( s1 - s0 >= sectors ) {
+                s0 = 0;
+                s1 = sectors - 1;
+            }
+        }
+        
+        int count = 0;
+        for ( int b = b0; b <= b1; b++ ) {
+            for ( int s = s0; s <= s1; s++ ) {
+                int c = b * sectors + ( ( s % sectors ) + sectors ) % sectors;
+                for ( int i = cellStart[ c ]; i < cellStart[ c + 1 ]; i++ ) {
+                    int idx = item[ i ];
+                    if ( direction[ idx ].Dot( dir ) >= minDot ) {
+                        results.push_back( idx );
+                        count++;
+                    }
+                }
+            }
+        }
+        return count;
+    }
+    
+}
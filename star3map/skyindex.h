@@ -0,0 +1,84 @@
+/*
+ *  skyindex
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#ifndef __STAR3MAP_SKYINDEX_H__
+#define __STAR3MAP_SKYINDEX_H__
+
+#include "r3/linear.h"
+
+#include <vector>
+
+namespace star3map {
+	
+    // Buckets unit vectors into a latitude / longitude grid about the z axis
+    // so that cone queries only touch the cells near the query direction.
+    class SkyIndex {
+    public:
+        SkyIndex();
+        
+        void Build( const std::vector< r3::Vec3f > & directions );
+        
+        // Appends the index of every direction within radius (radians)
+        // of dir.  Returns the number of indexes appended.
+        int Query( const r3::Vec3f & dir, float radius, std::vector< int > & results ) const;
+        
+        int Size() const {
+            return (int)direction.size();
+        }
+        int Bytes() const {
+            return (int)( cellStart.capacity() * sizeof( int ) + item.capacity() * sizeof( int ) +
+                          direction.capacity() * sizeof( r3::Vec3f ) );
+        }
+        
+    private:
+        int Cell( const r3::Vec3f & dir ) const;
+        
+        int bands;
+        int sectors;
+        std::vector< int > cellStart;   // bands * sectors + 1 offsets into item
+        std::vector< int > item;
+        std::vector< r3::Vec3f > direction;
+    };
+    
+}
+
+#endif //__STAR3MAP_SKYINDEX_H__
@@ -0,0 +1,371 @@
+/*
+ *  skyraster
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#include "skyraster.h"
+
+#include "r3/filesystem.h"
+#include "r3/image.h"
+#include "r3/memtrack.h"
+#include "r3/output.h"
+#include "r3/thread.h"
+#include "r3/trace.h"
+#include "r3/var.h"
+
+#include "r3/stb_truetype.h"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+
+using namespace std;
+using namespace r3;
+using namespace star3map;
+
+extern VarString app_font;
+
+VarInteger app_chartFontSize( "app_chartFontSize", "label height in pixels for offscreen sky charts", 0, 14 );
+
+namespace {
+    
+    map< string, SkyImage * > skyImages;
+    
+    // glyph atlas for chart labels, baked at a fixed height and scaled
+    struct SkyFont {
+        SkyFont() : loaded( false ) {}
+        bool loaded;
+        stbtt_bakedchar cdata[96]; // ASCII 32..126
+        SkyImage atlas;            // white, coverage in alpha, first row at the top
+        
+        bool Load() {
+            if ( loaded ) {
+                return atlas.width > 0;
+            }
+            loaded = true;
+            vector< uchar > ttf;
+            if ( FileReadToMemory( app_font.GetVal(), ttf ) == false || ttf.size() == 0 ) {
+                Output( "Unable to read chart font %s.", app_font.GetVal().c_str() );
+                return false;
+            }
+            int size = 512;
+            vector< uchar > bitmap( size * size );
+            stbtt_BakeFontBitmap( & ttf[0], 0, 32.0, & bitmap[0], size, size, 32, 96, cdata );
+            atlas.width = atlas.height = size;
+            atlas.rgba.resize( size * size * 4 );
+            for ( int i = 0; i < size * size; i++ ) {
+                atlas.rgba[ i * 4 + 0 ] = 255;
+                atlas.rgba[ i * 4 + 1 ] = 255;
+                atlas.rgba[ i * 4 + 2 ] = 255;
+                atlas.rgba[ i * 4 + 3 ] = bitmap[ i ];
+            }
+            MemoryTrack( MemoryCategory_Font, "chart atlas " + app_font.GetVal(), (int)( atlas.rgba.size() + sizeof( cdata ) ) );
+            return true;
+        }
+    };
+    SkyFont skyFont;
+    
+    float Clamp01( float f ) {
+        return f < 0.0f ? 0.0f : ( f > 1.0f ? 1.0f : f );
+    }
+    
+    // bilinear, t runs along the rows as stored
+    void Sample( const SkyImage & img, float s, float t, float *texel ) {
+        float x = s * img.width - 0.5f;
+        float y = t * img.height - 0.5f;
+        int x0 = (int)floor( x );
+        int y0 = (int)floor( y );
+        float fx = x - x0;
+        float fy = y - y0;
+        int xs[2] = { max( 0, min( img.width - 1, x0 ) ), max( 0, min( img.width - 1, x0 + 1 ) ) };
+        int ys[2] = { max( 0, min( img.height - 1, y0 ) ), max( 0, min( img.height - 1, y0 + 1 ) ) };
+        float w[4] = { ( 1 - fx ) * ( 1 - fy ), fx * ( 1 - fy ), ( 1 - fx ) * fy, fx * fy };
+        texel[0] = texel[1] = texel[2] = texel[3] = 0.0f;
+        for ( int i = 0; i < 4; i++ ) {
+            const uchar *p = & img.rgba[ ( ys[ i >> 1 ] * img.width + xs[ i & 1 ] ) * 4 ];
+            for ( int c = 0; c < 4; c++ ) {
+                texel[c] += w[i] * p[c];
+            }
+        }
+        for ( int c = 0; c < 4; c++ ) {
+            texel[c] *= 1.0f / 255.0f;
+        }
+    }
+    
+    void Blend( uchar *dst, float r, float g, float b, float a ) {
+        if ( a <= 0.0f ) {
+            return;
+        }
+        a = min( a, 1.0f );
+        float src[3] = { Clamp01( r ) * 255.0f, Clamp01( g ) * 255.0f, Clamp01( b ) * 255.0f };
+        for ( int c = 0; c < 3; c++ ) {
+            dst[c] = uchar( dst[c] + ( src[c] - dst[c] ) * a + 0.5f );
+        }
+    }
+    
+    float SegmentDistance( const Vec2f & p, const Vec2f & a, const Vec2f & b ) {
+        Vec2f ab = b - a;
+        Vec2f ap = p - a;
+        float len2 = ab.Dot( ab );
+        float t = len2 > 0.0f ? Clamp01( ap.Dot( ab ) / len2 ) : 0.0f;
+        Vec2f d = ap - ab * t;
+        return sqrt( d.Dot( d ) );
+    }
+    
+    struct SkyTile {
+        SkyScene *scene;
+        int x0, y0, x1, y1;
+    };
+    
+    struct SkyTileQueue {
+        SkyTileQueue() : next( 0 ) {}
+        vector< SkyTile > tiles;
+        int next;
+        Mutex mutex;
+        
+        bool Next( SkyTile & tile ) {
+            ScopedMutex m( mutex );
+            if ( next >= (int)tiles.size() ) {
+                return false;
+            }
+            tile = tiles[ next++ ];
+            return true;
+        }
+    };
+    
+    struct SkyRasterThread : public Thread {
+        SkyRasterThread( SkyTileQueue *tileQueue ) : queue( tileQueue ) {}
+        SkyTileQueue *queue;
+        virtual void Run() {
+            TraceThreadName( "SkyRasterThread" );
+            SkyTile t;
+            while ( queue->Next( t ) ) {
+                TraceScope ts( "RasterizeTile" );
+                t.scene->RasterizeTile( t.x0, t.y0, t.x1, t.y1 );
+            }
+        }
+    };
+    
+}
+
+namespace star3map {
+    
+    const SkyImage * GetSkyImage( const string & filename ) {
+        if ( skyImages.count( filename ) ) {
+            return skyImages[ filename ];
+        }
+        SkyImage *si = NULL;
+        Image< uchar > *img = LoadStbImage( filename, 4 );
+        if ( img && img->Data() && img->Width() > 0 ) {
+            si = new SkyImage;
+            si->width = img->Width();
+            si->height = img->Height();
+            uchar *d = (uchar *)img->Data();
+            si->rgba.assign( d, d + si->width * si->height * 4 );
+            MemoryTrack( MemoryCategory_Image, "chart " + filename, (int)si->rgba.size() );
+        } else {
+            Output( "Unable to load chart image %s.", filename.c_str() );
+        }
+        delete img;
+        skyImages[ filename ] = si;
+        return si;
+    }
+    
+    SkyScene::SkyScene( int sceneWidth, int sceneHeight ) : width( sceneWidth ), height( sceneHeight ) {
+        image.width = width;
+        image.height = height;
+        image.rgba.resize( width * height * 4 );
+        for ( int i = 0; i < width * height; i++ ) {
+            image.rgba[ i * 4 + 3 ] = 255;
+        }
+    }
+    
+    void SkyScene::AddSprite( const SkyImage *img, const Vec2f & center, float radius, const Vec4f & color ) {
+        if ( img == NULL ) {
+            return;
+        }
+        Vec4f c = color;
+        if ( radius < 1.0f ) {
+            // keep sub-pixel sprites from vanishing between pixel centers
+            c.w *= radius * radius;
+            radius = 1.0f;
+        }
+        SkyPrimitive p;
+        p.type = SkyPrimitive_Sprite;
+        p.p0 = center - Vec2f( radius, radius );
+        p.p1 = center + Vec2f( radius, radius );
+        p.st0 = Vec2f( 0, 0 );
+        p.st1 = Vec2f( 1, 1 );
+        p.color = c;
+        p.image = img;
+        prims.push_back( p );
+    }
+    
+    void SkyScene::AddLine( const Vec2f & a, const Vec2f & b, const Vec4f & color ) {
+        SkyPrimitive p;
+        p.type = SkyPrimitive_Line;
+        p.p0 = a;
+        p.p1 = b;
+        p.color = color;
+        p.image = NULL;
+        prims.push_back( p );
+    }
+    
+    bool SkyScene::AddLabel( const string & text, const Vec2f & position, const Vec4f & color ) {
+        if ( skyFont.Load() == false ) {
+            return false;
+        }
+        float scale = app_chartFontSize.GetVal() / 32.0f;
+        vector< SkyPrimitive > glyphs;
+        Bounds2f b;
+        float x = 0.0f;
+        for ( int i = 0; i < (int)text.size(); i++ ) {
+            int c = (uchar)text[i];
+            if ( c < 32 || c > 127 ) {
+                continue;
+            }
+            const stbtt_bakedchar & bc = skyFont.cdata[ c - 32 ];
+            // baked coordinates are y down from the baseline
+            SkyPrimitive p;
+            p.type = SkyPrimitive_Glyph;
+            p.p0 = Vec2f( x + bc.xoff * scale, -( bc.yoff + ( bc.y1 - bc.y0 ) ) * scale );
+            p.p1 = Vec2f( p.p0.x + ( bc.x1 - bc.x0 ) * scale, -bc.yoff * scale );
+            p.st0 = Vec2f( float( bc.x0 ) / skyFont.atlas.width, float( bc.y1 ) / skyFont.atlas.height );
+            p.st1 = Vec2f( float( bc.x1 ) / skyFont.atlas.width, float( bc.y0 ) / skyFont.atlas.height );
+            p.color = color;
+            p.image = & skyFont.atlas;
+            x += bc.xadvance * scale;
+            if ( bc.x1 > bc.x0 ) {
+                glyphs.push_back( p );
+                b.Add( p.p0 );
+                b.Add( p.p1 );
+            }
+        }
+        if ( glyphs.size() == 0 ) {
+            return false;
+        }
+        Vec2f offset( position.x - x * 0.5f, position.y - b.Max().y );
+        b.Min() += offset;
+        b.Max() += offset;
+        for ( int i = 0; i < (int)labels.size(); i++ ) {
+            if ( Overlap( labels[i], b ) ) {
+                return false;
+            }
+        }
+        labels.push_back( b );
+        for ( int i = 0; i < (int)glyphs.size(); i++ ) {
+            glyphs[i].p0 += offset;
+            glyphs[i].p1 += offset;
+            prims.push_back( glyphs[i] );
+        }
+        return true;
+    }
+    
+    void SkyScene::RasterizeTile( int x0, int y0, int x1, int y1 ) {
+        for ( int k = 0; k < (int)prims.size(); k++ ) {
+            const SkyPrimitive & p = prims[k];
+            float pad = p.type == SkyPrimitive_Line ? 1.0f : 0.0f;
+            int bx0 = max( x0, (int)floor( min( p.p0.x, p.p1.x ) - pad ) );
+            int by0 = max( y0, (int)floor( min( p.p0.y, p.p1.y ) - pad ) );
+            int bx1 = min( x1, (int)ceil( max( p.p0.x, p.p1.x ) + pad ) );
+            int by1 = min( y1, (int)ceil( max( p.p0.y, p.p1.y ) + pad ) );
+            if ( bx0 >= bx1 || by0 >= by1 ) {
+                continue;
+            }
+            for ( int j = by0; j < by1; j++ ) {
+                uchar *row = & image.rgba[ j * width * 4 ];
+                for ( int i = bx0; i < bx1; i++ ) {
+                    Vec2f c( i + 0.5f, j + 0.5f );
+                    if ( p.type == SkyPrimitive_Line ) {
+                        float cover = Clamp01( 1.0f - SegmentDistance( c, p.p0, p.p1 ) );
+                        Blend( row + i * 4, p.color.x, p.color.y, p.color.z, p.color.w * cover );
+                        continue;
+                    }
+                    float u = ( c.x - p.p0.x ) / ( p.p1.x - p.p0.x );
+                    float v = ( c.y - p.p0.y ) / ( p.p1.y - p.p0.y );
+                    if ( u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f ) {
+                        continue;
+                    }
+                    float t[4];
+                    Sample( *p.image, p.st0.x + u * ( p.st1.x - p.st0.x ), p.st0.y + v * ( p.st1.y - p.st0.y ), t );
+                    Blend( row + i * 4, p.color.x * t[0], p.color.y * t[1], p.color.z * t[2], p.color.w * t[3] );
+                }
+            }
+        }
+    }
+    
+    bool SkyScene::WritePng( const string & fn ) const {
+        return r3::WritePng( fn, width, height, 4, & image.rgba[0] );
+    }
+    
+    void RasterizeSkyScenes( const vector< SkyScene * > & scenes, int tileSize, int numThreads ) {
+        SkyTileQueue queue;
+        tileSize = max( 16, tileSize );
+        for ( int s = 0; s < (int)scenes.size(); s++ ) {
+            SkyScene *scene = scenes[s];
+            for ( int y = 0; y < scene->Height(); y += tileSize ) {
+                for ( int x = 0; x < scene->Width(); x += tileSize ) {
+                    SkyTile t;
+                    t.scene = scene;
+                    t.x0 = x;
+                    t.y0 = y;
+                    t.x1 = min( x + tileSize, scene->Width() );
+                    t.y1 = min( y + tileSize, scene->Height() );
+                    queue.tiles.push_back( t );
+                }
+            }
+        }
+        if ( numThreads <= 0 ) {
+            numThreads = GetNumProcessors();
+        }
+        numThreads = max( 1, min( numThreads, (int)queue.tiles.size() ) );
+        vector< SkyRasterThread * > threads;
+        for ( int i = 0; i < numThreads; i++ ) {
+            threads.push_back( new SkyRasterThread( & queue ) );
+            threads.back()->Start();
+        }
+        for ( int i = 0; i < numThreads; i++ ) {
+            threads[i]->Join();
+            delete threads[i];
+        }
+    }
+    
+}
@@ -0,0 +1,124 @@
+/*
+ *  skyraster
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+
+#ifndef __STAR3MAP_SKYRASTER_H__
+#define __STAR3MAP_SKYRASTER_H__
+
+#include "r3/bounds.h"
+#include "r3/common.h"
+#include "r3/linear.h"
+
+#include <string>
+#include <vector>
+
+namespace star3map {
+    
+    // 8 bit RGBA pixels in memory, first row at the bottom as with GL.
+    struct SkyImage {
+        SkyImage() : width( 0 ), height( 0 ) {}
+        int width;
+        int height;
+        std::vector< r3::uchar > rgba;
+    };
+    
+    // Sprite images for the offscreen renderer, loaded once by filename.
+    // Main thread only.
+    const SkyImage * GetSkyImage( const std::string & filename );
+    
+    enum SkyPrimitiveEnum {
+        SkyPrimitive_Sprite,
+        SkyPrimitive_Line,
+        SkyPrimitive_Glyph
+    };
+    
+    // Window space primitive, origin at lower left.  Sprites and glyphs are
+    // axis aligned rectangles from p0 to p1 textured from st0 to st1, lines
+    // run from p0 to p1 and are one pixel wide.
+    struct SkyPrimitive {
+        SkyPrimitiveEnum type;
+        r3::Vec2f p0, p1;
+        r3::Vec2f st0, st1;
+        r3::Vec4f color;
+        const SkyImage *image;
+    };
+    
+    // One chart.  Primitives are added on the main thread, then the image
+    // can be rasterized a tile at a time from any thread.  Primitives are
+    // drawn in the order they were added with source alpha blending.
+    class SkyScene {
+    public:
+        SkyScene( int sceneWidth, int sceneHeight );
+        
+        int Width() const { return width; }
+        int Height() const { return height; }
+        
+        void AddSprite( const SkyImage *image, const r3::Vec2f & center, float radius, const r3::Vec4f & color );
+        void AddLine( const r3::Vec2f & a, const r3::Vec2f & b, const r3::Vec4f & color );
+        // Text centered on x with its top at y.  Labels that would overlap
+        // an earlier label are dropped and false is returned.
+        bool AddLabel( const std::string & text, const r3::Vec2f & position, const r3::Vec4f & color );
+        
+        // Draws every primitive touching the tile [x0,x1) x [y0,y1).
+        void RasterizeTile( int x0, int y0, int x1, int y1 );
+        
+        const SkyImage & GetImage() const { return image; }
+        bool WritePng( const std::string & filename ) const;
+        
+        std::string filename;  // where the driver should write the result
+        
+    private:
+        int width;
+        int height;
+        std::vector< SkyPrimitive > prims;
+        std::vector< r3::Bounds2f > labels;
+        SkyImage image;
+    };
+    
+    // Rasterizes all the scenes, split into tileSize square tiles shared
+    // out across numThreads workers.  numThreads <= 0 uses one worker per
+    // processor.
+    void RasterizeSkyScenes( const std::vector< SkyScene * > & scenes, int tileSize, int numThreads );
+    
+}
+
+#endif //__STAR3MAP_SKYRASTER_H__
@@ -41,19 +41,30 @@
  */
 
 #include "star3map.h"
+#include "constellations.h"
 #include "satellite.h"
 #include "button.h"
+#include "starcatalog.h"
+#include "nameindex.h"
+#include "skyindex.h"
+#include "skyraster.h"
+#include "constellationgrid.h"
 
 #include "r3/command.h"
 #include "r3/common.h"
 #include "r3/draw.h"
 #include "r3/filesystem.h"
 #include "r3/http.h"
+#include "r3/memtrack.h"
 #include "r3/model.h"
 #include "r3/modelobj.h"
 #include "r3/output.h"
+#include "r3/profile.h"
+#include "r3/record.h"
+#include "r3/rendertarget.h"
 #include "r3/thread.h"
 #include "r3/time.h"
+#include "r3/trace.h"
 
 #include "r3/var.h"
 
@@ -80,11 +91,24 @@ VarBool app_useCoreLocation( "app_useCoreLocation", "use the location services t
 VarBool app_showSatellites( "app_showSatellites", "use TLE satellite data to show satellites", 0, false );
 VarString app_satelliteFile( "app_satelliteFile", "file to use for satellite data", 0, "visual.txt" );
 VarInteger app_maxSatellites( "app_maxSatellites", "maximum number of satellites to display", 0, 40 );
+VarFloat app_pickRadius( "app_pickRadius", "angular radius in degrees for tap to identify", 0, 3.0f );
 
 VarFloat app_inputDrag( "app_inputDrag", "drag factor on input for inertia effect", 0, .9 );
 
 VarFloat app_debugPhase( "app_debugPhase", "phase adjustment", 0, 0.0f );
 
+VarBool app_redrawAlways( "app_redrawAlways", "draw every frame, even when nothing on screen would change", 0, false );
+VarFloat app_redrawPixels( "app_redrawPixels", "on-screen motion in pixels below which a frame is skipped", 0, 1.0f );
+VarInteger app_framesDrawn( "app_framesDrawn", "frames drawn", Var_ReadOnly, 0 );
+VarInteger app_framesSkipped( "app_framesSkipped", "frames skipped because nothing on screen would change", Var_ReadOnly, 0 );
+
+VarBool app_skyLayer( "app_skyLayer", "draw the horizon and stars to an offscreen layer and reuse it while the view turns", 0, true );
+VarFloat app_skyLayerMargin( "app_skyLayerMargin", "extra size of the sky layer beyond the view, as a fraction of the view", 0, 0.25f );
+VarFloat app_skyLayerPixels( "app_skyLayerPixels", "drift in pixels of the stars under the sky layer that forces it to be redrawn", 0, 0.5f );
+VarInteger app_skyLayerMaxSize( "app_skyLayerMaxSize", "largest width or height of the sky layer", 0, 2048 );
+VarInteger app_skyLayersDrawn( "app_skyLayersDrawn", "times the sky layer was redrawn", Var_ReadOnly, 0 );
+VarInteger app_skyLayersReused( "app_skyLayersReused", "frames that reused the sky layer", Var_ReadOnly, 0 );
+
 extern VarFloat app_scale;
 extern VarFloat app_starScale;
 
@@ -92,6 +116,7 @@ bool GotCompassUpdate = false;
 bool GotLocationUpdate = false;
 
 extern void UpdateLatLon();
+extern int GetSecondsSince2000();
 extern Matrix4f platformOrientation;
 Matrix4f orientation;
 Matrix4f manualOrientation;
@@ -100,6 +125,8 @@ VarFloat app_manualPhi( "app_manualPhi", "phi for manual orientation", 0, 0 );
 VarFloat app_manualTheta( "app_manualTheta", "theta for manual orientation", 0, 0 );
 
 vector< Sprite > stars;
+StarCatalog starCatalog;
+NameIndex nameIndex;
 vector< Sprite > solarsystem;
 vector< Lines > constellations;
 vector< Button *> buttons;
@@ -119,6 +146,7 @@ namespace {
     Model *hemiModel;
     Model *sphereModel;
     Model *starsModel;
+    Model *constellationsModel;
     Texture2D *hemiTex;
     Texture2D *nTex;
     Texture2D *sTex;
@@ -139,6 +167,11 @@ namespace {
     bool GotSatelliteData = false;
     vector<Satellite> satellite;
     
+    ProfileTimer displayTimer( "star3map::Display" );
+    ProfileTimer starsTimer( "drawStars" );
+    ProfileTimer agingTimer( "ageDynamic" );
+    ProfileTimer labelTimer( "labelPlacement" );
+    
     enum AppModeEnum {
         AppMode_INVALID,
         AppMode_ViewStars,
@@ -150,12 +183,21 @@ namespace {
     
     void UpdateManualOrientation();
     
+    // Stars are stored as one point per star and drawn as point sprites,
+    // so their size can follow the view without touching the buffer.
     struct StarVert {
         Vec3f pos;
         uchar c[4];
-        Vec2f tc;
     };
     
+    // stars sharing a sprite diameter are contiguous in starsModel
+    struct StarSizeRange {
+        int first;
+        int count;
+        float diameter;
+    };
+    vector< StarSizeRange > starSizeRanges;
+    
     float magToDiam[] = { 2.0f, 1.5f, 1.25f, 1.0f, .85f, .75f, .5f };
     
     float GetSpriteDiameter( float magnitude ) {
@@ -175,10 +217,262 @@ namespace {
         string url;
         vector<uchar> urldata;
         virtual void Run() {
+            TraceThreadName( "ReadUrlThread" );
+            TraceScope ts( "UrlReadToMemory" );
             UrlReadToMemory( url, urldata );
         }
     };
     
+    void BuildStarsModel() {
+        map< float, vector< StarVert > > bySize;
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            Sprite & s = stars[i];
+            if ( s.magnitude > 4 ) {
+                continue;
+            }
+            Vec4f c = s.color * GetSpriteColorScale( s.magnitude ) * 255.f;
+            StarVert v;
+            v.pos = s.direction;
+            v.c[0] = c.x; v.c[1] = c.y; v.c[2] = c.z; v.c[3] = c.w;
+            bySize[ s.scale * GetSpriteDiameter( s.magnitude ) ].push_back( v );
+        }
+        vector< StarVert > data;
+        starSizeRanges.clear();
+        for ( map< float, vector< StarVert > >::iterator it = bySize.begin(); it != bySize.end(); ++it ) {
+            StarSizeRange r;
+            r.first = (int)data.size();
+            r.count = (int)it->second.size();
+            r.diameter = it->first;
+            starSizeRanges.push_back( r );
+            data.insert( data.end(), it->second.begin(), it->second.end() );
+        }
+        VertexBuffer & vb = starsModel->GetVertexBuffer();
+        vb.SetVarying( Varying_PositionBit | Varying_ColorBit );
+        vb.SetData( (int)data.size() * sizeof( StarVert ), data.size() ? & data[0] : NULL );
+        starsModel->SetPrimitive( Primitive_Points );
+    }
+    
+    // pixels per unit at unit distance in the center of the view
+    float PixelsPerUnit() {
+        return r_windowHeight.GetVal() / ( 2.0f * tan( ToRadians( r_fov.GetVal() * 0.5f ) ) );
+    }
+    
+    // point size of a star sprite of diameter 1
+    float StarPointScale() {
+        // the old billboards were 20 units across at unit distance
+        return 20.0f * app_starScale.GetVal() * app_scale.GetVal() * PixelsPerUnit();
+    }
+    
+    void DrawStars() {
+        ProfileScope ps( starsTimer );
+        float k = StarPointScale();
+        stars[0].tex->Bind( 0 );
+        stars[0].tex->Enable();
+        PointSpriteEnable();
+        VertexBuffer & vb = starsModel->GetVertexBuffer();
+        for ( int i = 0; i < (int)starSizeRanges.size(); i++ ) {
+            const StarSizeRange & r = starSizeRanges[i];
+            PointSize( r.diameter * k );
+            vb.SetRange( r.first * sizeof( StarVert ), r.count );
+            starsModel->Draw();
+        }
+        vb.ClearRange();
+        PointSpriteDisable();
+        stars[0].tex->Disable();
+    }
+    
+    // All constellation segments live in one static buffer, each Lines
+    // records its range so it can be drawn on its own.
+    void BuildConstellationsModel() {
+        vector< Vec3f > data;
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            Lines & l = constellations[i];
+            l.first = (int)data.size();
+            l.count = (int)l.vert.size();
+            data.insert( data.end(), l.vert.begin(), l.vert.end() );
+        }
+        VertexBuffer & vb = constellationsModel->GetVertexBuffer();
+        vb.SetVarying( Varying_PositionBit );
+        vb.SetData( (int)data.size() * sizeof( Vec3f ), data.size() ? & data[0] : NULL );
+        constellationsModel->SetPrimitive( Primitive_Lines );
+    }
+    
+    void DrawConstellation( const Lines & l ) {
+        if ( constellationsModel == NULL || l.count == 0 ) {
+            return;
+        }
+        VertexBuffer & vb = constellationsModel->GetVertexBuffer();
+        vb.SetRange( l.first * sizeof( Vec3f ), l.count );
+        constellationsModel->Draw();
+        vb.ClearRange();
+    }
+    
+    SkyIndex starIndex;
+    int starEpoch = 0; // bumped whenever the stars move
+    void BuildStarIndex() {
+        vector< Vec3f > dirs( stars.size() );
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            dirs[i] = stars[i].direction;
+        }
+        starIndex.Build( dirs );
+    }
+    
+    // Move the star sprites and constellation lines to the current date.
+    // The catalog only reports a change when the date has drifted past
+    // app_epochUpdateDays, so this is free on almost every frame.
+    void UpdateStarEpoch() {
+        float years = GetSecondsSince2000() / ( 365.25f * 24.0f * 60.0f * 60.0f );
+        if ( UpdateStarCatalogEpoch( starCatalog, years ) == false ) {
+            return;
+        }
+        if ( starCatalog.Size() != (int)stars.size() ) {
+            return;
+        }
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            stars[i].direction = starCatalog.direction[i];
+        }
+        starEpoch++;
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            Lines & l = constellations[i];
+            if ( l.star.size() != l.vert.size() ) {
+                continue;
+            }
+            l.center = Vec3f( 0, 0, 0 );
+            for ( int j = 0; j < (int)l.vert.size(); j++ ) {
+                l.vert[j] = starCatalog.direction[ l.star[j] ];
+                l.center += l.vert[j];
+            }
+            l.center.Normalize();
+            l.limit = 1.0f;
+            for ( int j = 0; j < (int)l.vert.size(); j++ ) {
+                l.limit = min( l.limit, l.center.Dot( l.vert[j] ) );
+            }
+        }
+        if ( starsModel ) {
+            BuildStarsModel();
+            BuildStarIndex();
+        }
+        if ( constellationsModel ) {
+            BuildConstellationsModel();
+        }
+    }
+    
+    // Cache signatures fold in everything a cache was built from, so a
+    // data update that keeps the counts still invalidates it.
+    uint SignatureAdd( uint sig, int i ) {
+        return sig * 31 + uint( i );
+    }
+    
+    uint SignatureAdd( uint sig, const string & str ) {
+        for ( int i = 0; i < (int)str.size(); i++ ) {
+            sig = sig * 31 + (uchar)str[i];
+        }
+        return SignatureAdd( sig, (int)str.size() );
+    }
+    
+    int NameIndexSignature() {
+        uint sig = 0x1234567;
+        sig = SignatureAdd( sig, (int)stars.size() );
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            sig = SignatureAdd( sig, stars[i].name );
+            sig = SignatureAdd( sig, i < (int)starCatalog.hipnum.size() ? starCatalog.hipnum[i] : 0 );
+        }
+        sig = SignatureAdd( sig, (int)solarsystem.size() );
+        for ( int i = 0; i < (int)solarsystem.size(); i++ ) {
+            sig = SignatureAdd( sig, solarsystem[i].name );
+        }
+        sig = SignatureAdd( sig, (int)constellations.size() );
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            sig = SignatureAdd( sig, constellations[i].name );
+        }
+        return int( sig );
+    }
+    
+    void BuildNameIndex() {
+        int signature = NameIndexSignature();
+        if ( nameIndex.Read( "nameindex.bin", signature ) ) {
+            return;
+        }
+        nameIndex.Clear();
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            ObjectHandle h( ObjectType_Star, i );
+            nameIndex.Add( stars[i].name, h );
+            if ( i < (int)starCatalog.hipnum.size() && starCatalog.hipnum[i] > 0 ) {
+                char hip[32];
+                r3Sprintf( hip, "HIP %d", starCatalog.hipnum[i] );
+                nameIndex.Add( hip, h );
+            }
+        }
+        for ( int i = 0; i < (int)solarsystem.size(); i++ ) {
+            nameIndex.Add( solarsystem[i].name, ObjectHandle( ObjectType_SolarSystem, i ) );
+        }
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            nameIndex.Add( constellations[i].name, ObjectHandle( ObjectType_Constellation, i ) );
+        }
+        nameIndex.Finalize();
+        if ( nameIndex.Write( "nameindex.bin", signature ) == false ) {
+            Output( "Unable to write name index cache." );
+        }
+    }
+    
+    ConstellationGrid constellationGrid;
+    void BuildConstellationGrid() {
+        // a precomputed grid can ship next to constellations.txt, otherwise
+        // build it from the figures and cache it
+        uint sig = SignatureAdd( 0x4347, (int)constellations.size() );
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            const Lines & l = constellations[i];
+            sig = SignatureAdd( sig, (int)l.star.size() );
+            for ( int j = 0; j < (int)l.star.size(); j++ ) {
+                sig = SignatureAdd( sig, l.star[j] );
+            }
+        }
+        int signature = int( sig );
+        if ( constellationGrid.Read( "constellations.bin", signature ) ) {
+            return;
+        }
+        constellationGrid.Build( constellations );
+        if ( constellationGrid.Write( "constellations.bin", signature ) == false ) {
+            Output( "Unable to write constellation grid cache." );
+        }
+    }
+    
+    void TrackCatalogMemory() {
+        int starBytes = (int)( stars.capacity() * sizeof( Sprite ) );
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            starBytes += (int)stars[i].name.capacity();
+        }
+        int lineBytes = (int)( constellations.capacity() * sizeof( Lines ) );
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            const Lines & l = constellations[i];
+            lineBytes += (int)( l.name.capacity() + l.vert.capacity() * sizeof( Vec3f ) + l.star.capacity() * sizeof( int ) );
+        }
+        MemoryTrack( MemoryCategory_Catalog, "stars", starBytes );
+        MemoryTrack( MemoryCategory_Catalog, "constellations", lineBytes );
+        MemoryTrack( MemoryCategory_Catalog, "starCatalog", starCatalog.Bytes() );
+        MemoryTrack( MemoryCategory_Catalog, "starIndex", starIndex.Bytes() );
+        MemoryTrack( MemoryCategory_Catalog, "nameIndex", nameIndex.Bytes() );
+        MemoryTrack( MemoryCategory_Catalog, "constellationGrid", constellationGrid.Bytes() );
+    }
+    
+    void FindObject( const vector< Token > & tokens ) {
+        if ( tokens.size() < 2 ) {
+            Output( "usage: findObject <name prefix>" );
+            return;
+        }
+        string prefix = tokens[1].valString;
+        for ( int i = 2; i < (int)tokens.size(); i++ ) {
+            prefix += " " + tokens[i].valString;
+        }
+        vector< const NameIndex::Entry * > results;
+        nameIndex.Find( prefix, results );
+        for ( int i = 0; i < (int)results.size(); i++ ) {
+            const char *typeName[] = { "invalid", "star", "solarsystem", "constellation", "satellite" };
+            Output( "%s - %s %d", results[i]->name.c_str(), typeName[ results[i]->handle.type ], results[i]->handle.index );
+        }
+    }
+    CommandFunc FindObjectCmd( "findObject", "find stars, planets and constellations by name prefix", FindObject );
+    
     bool initialized = false;
     ReadUrlThread *twoLineElements;
     void Initialize() {
@@ -256,51 +550,26 @@ namespace {
         }
         {
             starsModel = new Model( "stars" );
-            vector< StarVert > data;
-            for ( int i = 0; i < (int)stars.size(); i++ ) {
-                Sprite & s = stars[i];
-                if ( s.magnitude > 4 ) {
-                    continue;
-                }
-                Vec4f c = s.color * GetSpriteColorScale( s.magnitude ) * 255.f;
-                Matrix4f mRot = RotateTo( s.direction );
-                Matrix4f mScale;
-                float sc = s.scale * GetSpriteDiameter( s.magnitude ) * app_starScale.GetVal() * app_scale.GetVal();
-                mScale.SetScale( Vec3f( sc, sc, 1 ) );
-                Matrix4f mTrans;
-                mTrans.SetTranslate( Vec3f( 0, 0, -1 ) );
-                Matrix4f m = mRot * mScale * mTrans;
-                StarVert v;
-                v.c[0] = c.x; v.c[1] = c.y; v.c[2] = c.z; v.c[3] = c.w;
-                v.pos = m * Vec3f( -10, -10, 0 );
-                v.tc = Vec2f( 0, 0 );
-                data.push_back( v );
-                v.pos = m * Vec3f(  10, -10, 0 );
-                v.tc = Vec2f( 1, 0 );
-                data.push_back( v );
-                v.pos = m * Vec3f(  10,  10, 0 );
-                v.tc = Vec2f( 1, 1 );
-                data.push_back( v );
-                v.pos = m * Vec3f( -10,  10, 0 );
-                v.tc = Vec2f( 0, 1 );
-                data.push_back( v );				
-            }
-            VertexBuffer & vb = starsModel->GetVertexBuffer();
-            vb.SetVarying( Varying_PositionBit | Varying_ColorBit | Varying_TexCoord0Bit );
-            vb.SetData( (int)data.size() * sizeof( StarVert ), & data[0] );
-            starsModel->SetPrimitive( Primitive_Quads );
-            
+            BuildStarsModel();
+        }
+        {
+            constellationsModel = new Model( "constellations" );
+            BuildConstellationsModel();
         }
+        BuildStarIndex();
+        BuildNameIndex();
+        BuildConstellationGrid();
+        TrackCatalogMemory();
 	
 	
-        hemiTex = CreateTexture2DFromFile( "hemi.png", TextureFormat_RGBA );
-        nTex = CreateTexture2DFromFile( "n.png", TextureFormat_RGBA );
-        sTex = CreateTexture2DFromFile( "s.png", TextureFormat_RGBA );
-        eTex = CreateTexture2DFromFile( "e.png", TextureFormat_RGBA );
-        wTex = CreateTexture2DFromFile( "w.png", TextureFormat_RGBA );
-        testTex = CreateTexture2DFromFile( "test.jpg", TextureFormat_RGB );
-        earthTex = CreateTexture2DFromFile( "earth.png", TextureFormat_RGB );
-        satTex = CreateTexture2DFromFile( "spacestation.png", TextureFormat_RGBA );
+        hemiTex = CreateTexture2DFromFileAsync( "hemi.png", TextureFormat_RGBA );
+        nTex = CreateTexture2DFromFileAsync( "n.png", TextureFormat_RGBA );
+        sTex = CreateTexture2DFromFileAsync( "s.png", TextureFormat_RGBA );
+        eTex = CreateTexture2DFromFileAsync( "e.png", TextureFormat_RGBA );
+        wTex = CreateTexture2DFromFileAsync( "w.png", TextureFormat_RGBA );
+        testTex = CreateTexture2DFromFileAsync( "test.jpg", TextureFormat_RGB );
+        earthTex = CreateTexture2DFromFileAsync( "earth.png", TextureFormat_RGB );
+        satTex = CreateTexture2DFromFileAsync( "spacestation.png", TextureFormat_RGBA );
 	
         toggleCompass = new ToggleButton( "crose64.png", "app_useCompass" );
         viewGlobe = new PushButton( "globe64.png", "setAppMode viewGlobe" );
@@ -359,52 +628,117 @@ namespace {
         }
     }
     
-    struct DrawNonOverlappingStrings {
-        vector< OrientedBounds2f > reserved;
+    // Uniform grid over normalized device coordinates, so a label is only
+    // tested against the boxes in the cells its screen bounds touch.
+    struct LabelGrid {
+        enum { Cells = 16 };
         vector< OrientedBounds2f > obs;
+        vector< Bounds2f > aabb;
+        vector< int > cell[ Cells * Cells ];
+        mutable vector< int > tested;
+        mutable int query;
+        
+        LabelGrid() : query( 0 ) {}
+        
+        int size() const {
+            return (int)obs.size();
+        }
+        
+        void clear() {
+            obs.clear();
+            aabb.clear();
+            tested.clear();
+            for ( int i = 0; i < Cells * Cells; i++ ) {
+                cell[ i ].clear();
+            }
+        }
+        
+        static int CellCoord( float f ) {
+            return max( 0, min( int( Cells ) - 1, int( ( f + 1.0f ) * 0.5f * Cells ) ) );
+        }
+        
+        void push_back( const OrientedBounds2f & ob ) {
+            Bounds2f b = GetBounds( ob );
+            int idx = (int)obs.size();
+            obs.push_back( ob );
+            aabb.push_back( b );
+            tested.push_back( -1 );
+            for ( int y = CellCoord( b.Min().y ); y <= CellCoord( b.Max().y ); y++ ) {
+                for ( int x = CellCoord( b.Min().x ); x <= CellCoord( b.Max().x ); x++ ) {
+                    cell[ y * Cells + x ].push_back( idx );
+                }
+            }
+        }
+        
+        bool Intersects( const OrientedBounds2f & ob ) const {
+            Bounds2f b = GetBounds( ob );
+            query++;
+            for ( int y = CellCoord( b.Min().y ); y <= CellCoord( b.Max().y ); y++ ) {
+                for ( int x = CellCoord( b.Min().x ); x <= CellCoord( b.Max().x ); x++ ) {
+                    const vector< int > & c = cell[ y * Cells + x ];
+                    for ( int i = 0; i < (int)c.size(); i++ ) {
+                        int idx = c[ i ];
+                        if ( tested[ idx ] == query ) {
+                            continue; // spans more than one cell
+                        }
+                        tested[ idx ] = query;
+                        if ( Overlap( b, aabb[ idx ] ) && Intersect( ob, obs[ idx ] ) ) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+    };
+    
+    struct DrawNonOverlappingStrings {
+        LabelGrid reserved;
+        LabelGrid obs;
 	
         bool CanDrawString( const string & str, const Vec3f & direction, const Vec3f & lookDir, float limit ) {
+            ProfileScope ps( labelTimer );
             if ( lookDir.Dot( direction ) < limit ) {
                 return false;
             }
             OrientedBounds2f ob = StringBounds( str, direction );
-            for ( int i = 0; i < (int)obs.size(); i++ ) {
-                if ( Intersect( ob, obs[ i ] ) ) {
-                    return false; // intersected, so don't draw this one
-                }
+            if ( ob.empty ) {
+                return false;
             }
-            return true;
+            return obs.Intersects( ob ) == false;
         }
 	
         void ReserveString( const string & str, const Vec3f & direction, const Vec3f & lookDir, float limit ) {
+            ProfileScope ps( labelTimer );
             if ( lookDir.Dot( direction ) < limit ) {
                 return;
             }
             OrientedBounds2f ob = StringBounds( str, direction );
+            if ( ob.empty ) {
+                return;
+            }
             reserved.push_back( ob );
         }
         
         void DrawString( const string & str, const Vec3f & direction, const Vec3f & lookDir, float limit ) {
-            if ( lookDir.Dot( direction ) < limit ) {
-                return;
-            }
-            
-            OrientedBounds2f ob = StringBounds( str, direction );
-            if ( ob.empty ) {
-                return;
-            }
-            
-            for ( int i = 0; i < (int)obs.size(); i++ ) {
-                if ( Intersect( ob, obs[ i ] ) ) {
-                    return; // intersected, so don't draw this one
+            OrientedBounds2f ob;
+            {
+                // time the placement test only, not the text itself
+                ProfileScope ps( labelTimer );
+                if ( lookDir.Dot( direction ) < limit ) {
+                    return;
                 }
-            }
-            for ( int i = 0; i < (int)reserved.size(); i++ ) {
-                if ( Intersect( ob, reserved[ i ] ) ) {
+                
+                ob = StringBounds( str, direction );
+                if ( ob.empty ) {
+                    return;
+                }
+                
+                if ( obs.Intersects( ob ) || reserved.Intersects( ob ) ) {
                     return; // intersected, so don't draw this one
                 }
+                obs.push_back( ob );
             }
-            obs.push_back( ob );
             ::DrawString( str, direction );
             if ( app_debugLabels.GetVal() ) {
                 if ( app_debugLabels.GetVal() > 1 ) {
@@ -521,6 +855,7 @@ namespace {
     map< string, DynamicLabel > dynamicLabels;
     
     void AgeDynamicLabels() {
+        ProfileScope ps( agingTimer );
         if ( app_pauseAging.GetVal() ) {
             return;
         }
@@ -559,13 +894,7 @@ namespace {
         void render() {
             if ( state != DState_Terminate ) {
                 SetColor( Vec4f( color.x, color.y, color.z, currAlpha ) );
-                ImVarying( 0 );
-                ImBegin( Primitive_Lines );
-                for( int j = 0; j < (int)lines->vert.size(); j++ ) {
-                    Vec3f & v = lines->vert[ j ];
-                    ImVertex( v.x, v.y, v.z );
-                }
-                ImEnd();
+                DrawConstellation( *lines );
             }
         }
     };
@@ -573,6 +902,7 @@ namespace {
     map< Lines *, DynamicLines > dynamicLines;
     
     void AgeDynamicLines() {
+        ProfileScope ps( agingTimer );
         if ( app_pauseAging.GetVal() ) {
             return;
         }		
@@ -642,10 +972,8 @@ namespace {
     CommandFunc SetAppModeCmd( "setAppMode", "set app mode :-)", SetAppMode );
     
     void UpdateManualOrientation() {
-        Matrix4f phiMat = Rotationf( Vec3f( 1, 0, 0 ), -ToRadians( app_manualPhi.GetVal() + 90 ) ).GetMatrix4();
-        Matrix4f thetaMat = Rotationf( Vec3f( 0, 0, 1 ), -ToRadians( app_manualTheta.GetVal() ) ).GetMatrix4();
         //Output( "Updating manualOrientation from phi=%f theta=%f", app_manualPhi.GetVal(), app_manualTheta.GetVal() );
-        manualOrientation = phiMat * thetaMat;
+        manualOrientation = ManualOrientation( app_manualPhi.GetVal(), app_manualTheta.GetVal() );
     }
 }
 
@@ -680,8 +1008,50 @@ namespace star3map {
 	
     }
 
+    Matrix4f pickImvp;
+    bool pickValid = false;
+    string pickedLabel;
+    Vec3f pickedDirection;
+    
+    bool ComparePickResult( const PickResult & a, const PickResult & b ) {
+        if ( a.magnitude != b.magnitude ) {
+            return a.magnitude < b.magnitude;
+        }
+        return a.angle < b.angle;
+    }
+    
+    void AddPickResult( vector< PickResult > & results, const ObjectHandle & h, const string & name, const Vec3f & dir, float magnitude, const Vec3f & pickDir ) {
+        PickResult r;
+        r.handle = h;
+        r.name = name;
+        r.direction = dir;
+        r.magnitude = magnitude;
+        r.angle = acos( max( -1.0f, min( 1.0f, pickDir.Dot( dir ) ) ) );
+        results.push_back( r );
+    }
+    
+    void PickObject( int x, int y ) {
+        vector< PickResult > results;
+        Pick( x, y, app_pickRadius.GetVal(), results, 1 );
+        if ( results.size() == 0 || results[0].name.size() == 0 ) {
+            // nothing close, so name the constellation that was tapped
+            int c = PickConstellation( x, y );
+            if ( c < 0 ) {
+                pickedLabel.clear();
+                return;
+            }
+            pickedLabel = constellations[ c ].name;
+            pickedDirection = constellations[ c ].center;
+            Output( "Picked %s", pickedLabel.c_str() );
+            return;
+        }
+        pickedLabel = results[0].name;
+        pickedDirection = results[0].direction;
+        Output( "Picked %s", pickedLabel.c_str() );
+    }
+    
     bool ProcessInput( bool active, int x, int y ) {
-        
+        RequestRedraw();
         bool handled = false;
         for ( int i = 0; i < (int)buttons.size(); i++ ) {
             handled = handled || buttons[i]->ProcessInput( active, x, y );
@@ -702,10 +1072,20 @@ namespace star3map {
 	
         static int prevx;
         static int prevy;
+        static int tapx;
+        static int tapy;
+        static bool tapMoved;
         float dx;
         float dy;
         // If the UI didn't handle the input, then try to use it as "global" input
         if ( active && handled == false ) {
+            if ( prevx == 0 && prevy == 0 ) {
+                tapx = x;
+                tapy = y;
+                tapMoved = false;
+            } else if ( abs( x - tapx ) + abs( y - tapy ) > 8 ) {
+                tapMoved = true;
+            }
             if ( prevx != 0 && prevy != 0 ) {
                 float factor = 0.25 * r_fov.GetVal() / 90.0f;
                 dx = factor * ( x - prevx ) ;
@@ -737,6 +1117,9 @@ namespace star3map {
         }
         
         if ( active == false ) {
+            if ( touchActive && handled == false && tapMoved == false && appMode == AppMode_ViewStars ) {
+                PickObject( x, y );
+            }
             prevx = prevy = 0;
         }
 	
@@ -745,6 +1128,200 @@ namespace star3map {
         return true;
     }
     
+    // The star frame as seen from app_latitude, app_longitude at the
+    // current time, with the local horizon in the view's xz plane.
+    Matrix4f ComputeStarFrame() {
+        float latitude = ToRadians( app_latitude.GetVal() );
+        float longitude = ToRadians( app_longitude.GetVal() );
+        Matrix4f xout = Rotationf( Vec3f( 0, 1, 0 ), -R3_PI / 2.0f ).GetMatrix4(); // current Lat/Lon now at { 0, 0, 1 }, with z up
+        Matrix4f zup = Rotationf( Vec3f( 1, 0, 0 ), -R3_PI / 2.0f ).GetMatrix4();  // current Lat/Lon now at { 1, 0, 0 }, with z up
+        Matrix4f lat = Rotationf( Vec3f( 0, 1, 0 ), latitude ).GetMatrix4();       // current Lat/Lon now at { 1, 0, 0 }, with y up
+        Matrix4f lon = Rotationf( Vec3f( 0, 0, 1 ), -longitude ).GetMatrix4();
+        float phaseEarthRot = GetCurrentEarthPhase();
+        Matrix4f phase = Rotationf( Vec3f( 0, 0, 1 ), -phaseEarthRot ).GetMatrix4();
+	
+        return xout * zup * lat * lon * phase;
+    }
+    
+    // largest angle in radians between corresponding axes of a and b
+    float AxisAngle( const Matrix4f & a, const Matrix4f & b ) {
+        float d = 1.0f;
+        for ( int i = 0; i < 3; i++ ) {
+            Vec3f ra( a( i, 0 ), a( i, 1 ), a( i, 2 ) );
+            Vec3f rb( b( i, 0 ), b( i, 1 ), b( i, 2 ) );
+            d = min( d, ra.Dot( rb ) );
+        }
+        return acos( max( -1.0f, min( 1.0f, d ) ) );
+    }
+    
+    // The horizon and the stars only move when the view turns or the sky
+    // does, so they are drawn to an offscreen layer a little wider than the
+    // view and drawn back as a single quad.  A layer drawn through a pinhole
+    // reprojects exactly under any rotation of the view, so it is reused
+    // until the view turns past its edge or the stars drift under it.
+    struct SkyLayer {
+        SkyLayer() : fb( NULL ), valid( false ), failed( false ) {}
+        FrameBuffer *fb;
+        bool valid;
+        bool failed;          // no framebuffer support, draw directly
+        Matrix4f view;        // orientation the layer was drawn from
+        Matrix4f comp;        // star frame it was drawn with
+        Matrix4f mvp;
+        float tanHalfX;
+        float tanHalfY;
+        float pointScale;
+        int epoch;
+        int textures;         // TextureLoadGeneration() when drawn
+    };
+    SkyLayer skyLayer;
+    
+    int PowerOfTwoAtLeast( int n ) {
+        int p = 1;
+        while ( p < n ) {
+            p <<= 1;
+        }
+        return p;
+    }
+    
+    // Star sprites are clipped by their centers, so the view has to stay
+    // this far inside the layer for stars just past its edge to show.
+    float SkyLayerGuardPixels() {
+        float diameter = 0.0f;
+        for ( int i = 0; i < (int)starSizeRanges.size(); i++ ) {
+            diameter = max( diameter, starSizeRanges[i].diameter );
+        }
+        return 0.5f * diameter * StarPointScale() + 1.0f;
+    }
+    
+    // Does the current view, turned by orientation, lie inside the layer?
+    // Edges of the view are great circles, which the layer's projection
+    // keeps straight, so checking the corners is enough.
+    bool ViewInSkyLayer( float guard ) {
+        const SkyLayer & sl = skyLayer;
+        float ppu = PixelsPerUnit();
+        float tanX = 0.5f * r_windowWidth.GetVal() / ppu;
+        float tanY = 0.5f * r_windowHeight.GetVal() / ppu;
+        Matrix4f iview = orientation.Inverse();
+        float w = float( sl.fb->Width() );
+        float h = float( sl.fb->Height() );
+        for ( int i = 0; i < 4; i++ ) {
+            Vec3f d = iview * Vec3f( ( i & 1 ) ? tanX : -tanX, ( i & 2 ) ? tanY : -tanY, -1 );
+            Vec4f c = sl.mvp * Vec4f( d.x, d.y, d.z, 1 );
+            if ( c.w <= 0.0f ) {
+                return false;
+            }
+            float x = ( c.x / c.w * 0.5f + 0.5f ) * w;
+            float y = ( c.y / c.w * 0.5f + 0.5f ) * h;
+            if ( x < guard || y < guard || x > w - guard || y > h - guard ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    void DrawSkyLayerContents( const Matrix4f & comp ) {
+        DrawUpHemisphere();
+        PushTransform();
+        ApplyTransform( comp );
+        DrawStars();
+        PopTransform();
+    }
+    
+    // Make the layer current for this view, redrawing it if needed.  False
+    // if it can't cover the view, and the sky should be drawn directly.
+    bool UpdateSkyLayer( const Matrix4f & comp ) {
+        SkyLayer & sl = skyLayer;
+        if ( sl.failed ) {
+            return false;
+        }
+        float margin = 1.0f + max( 0.0f, app_skyLayerMargin.GetVal() );
+        int w = PowerOfTwoAtLeast( int( ceil( r_windowWidth.GetVal() * margin ) ) );
+        int h = PowerOfTwoAtLeast( int( ceil( r_windowHeight.GetVal() * margin ) ) );
+        while ( w > app_skyLayerMaxSize.GetVal() && w > 1 ) {
+            w >>= 1;
+        }
+        while ( h > app_skyLayerMaxSize.GetVal() && h > 1 ) {
+            h >>= 1;
+        }
+        if ( sl.fb == NULL || sl.fb->Width() != w || sl.fb->Height() != h ) {
+            delete sl.fb;
+            sl.valid = false;
+            sl.fb = FrameBuffer::Create( "skyLayer", w, h );
+            if ( sl.fb == NULL ) {
+                Output( "Drawing the sky directly, without a sky layer." );
+                sl.failed = true;
+                return false;
+            }
+        }
+        
+        float ppu = PixelsPerUnit();
+        float pointScale = StarPointScale();
+        float guard = SkyLayerGuardPixels();
+        if ( sl.valid && sl.tanHalfY == 0.5f * h / ppu && sl.pointScale == pointScale && sl.epoch == starEpoch &&
+             sl.textures == TextureLoadGeneration() &&
+             AxisAngle( comp, sl.comp ) * ppu <= app_skyLayerPixels.GetVal() && ViewInSkyLayer( guard ) ) {
+            app_skyLayersReused.SetVal( app_skyLayersReused.GetVal() + 1 );
+            return true;
+        }
+        
+        // same pixel density as the view, so stars come out the same size
+        sl.view = orientation;
+        sl.comp = comp;
+        sl.tanHalfX = 0.5f * w / ppu;
+        sl.tanHalfY = 0.5f * h / ppu;
+        sl.pointScale = pointScale;
+        sl.epoch = starEpoch;
+        sl.textures = TextureLoadGeneration();
+        Matrix4f proj = Perspective( 2.0f * ToDegrees( atan( sl.tanHalfY ) ), sl.tanHalfX / sl.tanHalfY, 0.5f, 100.0f );
+        sl.mvp = proj * sl.view;
+        sl.valid = ViewInSkyLayer( guard );
+        if ( sl.valid == false ) {
+            // clamped by app_skyLayerMaxSize
+            return false;
+        }
+        
+        sl.fb->Bind();
+        Clear();
+        PushTransform();
+        ClearTransform();
+        ApplyTransform( sl.mvp );
+        DrawSkyLayerContents( comp );
+        PopTransform();
+        sl.fb->Unbind();
+        app_skyLayersDrawn.SetVal( app_skyLayersDrawn.GetVal() + 1 );
+        return true;
+    }
+    
+    // Draw the horizon and the stars with the current transform at
+    // projection * orientation.
+    void DrawSkyLayer( const Matrix4f & comp ) {
+        if ( app_skyLayer.GetVal() == false || UpdateSkyLayer( comp ) == false ) {
+            DrawSkyLayerContents( comp );
+            return;
+        }
+        
+        // the layer's image plane, placed back in the local frame
+        const SkyLayer & sl = skyLayer;
+        Matrix4f iview = sl.view.Inverse();
+        Texture2D *tex = sl.fb->GetColorTexture();
+        BlendDisable();
+        tex->Bind( 0 );
+        tex->Enable();
+        SetColor( Vec4f( 1, 1, 1, 1 ) );
+        ImVarying( Varying_TexCoord0Bit );
+        ImBegin( Primitive_Quads );
+        float corner[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+        for ( int i = 0; i < 4; i++ ) {
+            float x = corner[i][0];
+            float y = corner[i][1];
+            ImTexCoord( 0, x * 0.5f + 0.5f, y * 0.5f + 0.5f );
+            ImVertex( iview * Vec3f( x * sl.tanHalfX, y * sl.tanHalfY, -1 ) );
+        }
+        ImEnd();
+        tex->Disable();
+        BlendEnable();
+    }
+    
     void DisplayViewStars() {
         DrawNonOverlappingStrings nos;
 	
@@ -755,16 +1332,7 @@ namespace star3map {
         r3::Matrix4f proj = r3::Perspective( r_fov.GetVal(), float(r_windowWidth.GetVal()) / r_windowHeight.GetVal(), 0.5f, 100.0f );
         ApplyTransform( proj );
 	
-        float latitude = ToRadians( app_latitude.GetVal() );
-        float longitude = ToRadians( app_longitude.GetVal() );
-        Matrix4f xout = Rotationf( Vec3f( 0, 1, 0 ), -R3_PI / 2.0f ).GetMatrix4(); // current Lat/Lon now at { 0, 0, 1 }, with z up
-        Matrix4f zup = Rotationf( Vec3f( 1, 0, 0 ), -R3_PI / 2.0f ).GetMatrix4();  // current Lat/Lon now at { 1, 0, 0 }, with z up
-        Matrix4f lat = Rotationf( Vec3f( 0, 1, 0 ), latitude ).GetMatrix4();       // current Lat/Lon now at { 1, 0, 0 }, with y up
-        Matrix4f lon = Rotationf( Vec3f( 0, 0, 1 ), -longitude ).GetMatrix4();
-        float phaseEarthRot = GetCurrentEarthPhase();
-        Matrix4f phase = Rotationf( Vec3f( 0, 0, 1 ), -phaseEarthRot ).GetMatrix4();
-	
-        Matrix4f comp = ( xout * zup * lat * lon * phase );
+        Matrix4f comp = ComputeStarFrame();
         
 	
         BlendFunc( BlendFunc_SrcAlpha, BlendFunc_OneMinusSrcAlpha );
@@ -782,22 +1350,27 @@ namespace star3map {
         float limit = lookDir.Dot( corner );
         
         float labelLimit = ( limit + 8 ) / 9.0f;
+        
+        pickImvp = imvp;
+        pickValid = true;
 	
 	
         PushTransform(); // 1
         ApplyTransform( orientation );			
         
-        // draw horizon hemisphere indicator
-        DrawUpHemisphere();	
+        // draw horizon hemisphere indicator and stars
+        DrawSkyLayer( comp );
 	
         ApplyTransform( comp );
 	
         Matrix3f local = ToMatrix3( comp );
         UpVector = local.GetRow(2); // to orient text correctly
         
-        // draw constellations
-        for ( int i = 0; i < (int)constellations.size(); i++ ) {
-            Lines &l = constellations[ i ];
+        // draw constellations that own part of the view cone
+        vector< int > visibleConstellations;
+        constellationGrid.Query( lookDir, acos( limit ), visibleConstellations );
+        for ( int k = 0; k < (int)visibleConstellations.size(); k++ ) {
+            Lines &l = constellations[ visibleConstellations[ k ] ];
             Vec4f c( .5, .5, .7, .5 );
             Vec4f cl( .5, .5, .7, .8 );
             if ( lookDir.Dot( l.center ) > l.limit ) {
@@ -881,13 +1454,7 @@ namespace star3map {
             }
         }
         
-        // draw stars
-        {
-            stars[0].tex->Bind( 0 );
-            stars[0].tex->Enable();
-            starsModel->Draw();
-            stars[0].tex->Disable();
-        }
+        FlushSprites();
 	
         // draw satellites
         /*if ( app_showSatellites.GetVal() ) {
@@ -928,21 +1495,31 @@ namespace star3map {
         }*/
 		
 		
+        // mark the labels still in view as seen before aging, as the
+        // constellations do, or after an idle stretch they are dropped
+        // and fade in all over again
+        if ( dynamicLabelDot > 0.0f && dynamicLabels.count( dynamicLabel ) ) {
+            dynamicLabels[ dynamicLabel ].seen();
+        }
+        if ( pickedLabel.size() > 0 && dynamicLabels.count( pickedLabel ) ) {
+            dynamicLabels[ pickedLabel ].seen();
+        }
         AgeDynamicLabels();
         DrawDynamicLabels( nos );
 		
-        if ( dynamicLabelDot > 0.0f ) {
-            if ( dynamicLabels.count( dynamicLabel )  == 0) {
-                if ( nos.CanDrawString( dynamicLabel, dynamicLabelDirection, lookDir, limit ) ) {
-                    DynamicLabel dl( dynamicLabel, dynamicLabelDirection, lookDir, limit, Vec4f( 1, 1, 1, 1), 1.0f );
-                    dynamicLabels[ dl.name ] = dl;
-                }
-            } else {
-                dynamicLabels[ dynamicLabel ].seen();
+        if ( dynamicLabelDot > 0.0f && dynamicLabels.count( dynamicLabel ) == 0 ) {
+            if ( nos.CanDrawString( dynamicLabel, dynamicLabelDirection, lookDir, limit ) ) {
+                DynamicLabel dl( dynamicLabel, dynamicLabelDirection, lookDir, limit, Vec4f( 1, 1, 1, 1), 1.0f );
+                dynamicLabels[ dl.name ] = dl;
             }
         }
 		
 
+        if ( pickedLabel.size() > 0 && dynamicLabels.count( pickedLabel ) == 0 ) {
+            DynamicLabel dl( pickedLabel, pickedDirection, lookDir, limit, Vec4f( 1, 1, .6, 1 ), 1.0f );
+            dynamicLabels[ dl.name ] = dl;
+        }
+        
         if ( culled != prev_culled ) {
             //Output( "Culled %d and drew %d", culled, drew );
             prev_culled = culled;
@@ -1083,7 +1660,10 @@ namespace star3map {
         DepthTestDisable();
     }
 	
-    void Display() {
+    // Everything Display() does before drawing, split out so that
+    // NeedsDisplay() can compare the view this frame would show.
+    void PrepareFrame() {
+        UpdateStarEpoch();
         Initialize();  // do this once instead?
 				
         ApplyInputInertia();
@@ -1112,6 +1692,102 @@ namespace star3map {
         orientation = app_useCompass.GetVal() ? platformOrientation : manualOrientation;
 				
         UpdateLatLon();
+    }
+    
+    // what the last frame drawn was drawn from
+    struct DrawnView {
+        DrawnView() : valid( false ) {}
+        bool valid;
+        AppModeEnum mode;
+        Matrix4f orientation;
+        float fov;
+        float latitude;
+        float longitude;
+        float phase;
+        float globeLat;
+        float globeLon;
+        int width;
+        int height;
+    };
+    DrawnView drawnView;
+    bool framePrepared = false;
+    
+    void RememberView() {
+        drawnView.valid = true;
+        drawnView.mode = appMode;
+        drawnView.orientation = orientation;
+        drawnView.fov = r_fov.GetVal();
+        drawnView.latitude = app_latitude.GetVal();
+        drawnView.longitude = app_longitude.GetVal();
+        drawnView.phase = app_phaseEarthRotation.GetVal();
+        drawnView.globeLat = globeViewLat;
+        drawnView.globeLon = globeViewLon;
+        drawnView.width = r_windowWidth.GetVal();
+        drawnView.height = r_windowHeight.GetVal();
+    }
+    
+    // How far, in pixels, anything on screen would move from the last frame
+    // drawn.  Rotations are taken at the center of the view, fov changes at
+    // the edge.
+    float ViewMotionPixels() {
+        const DrawnView & dv = drawnView;
+        float h = r_windowHeight.GetVal();
+        float tanHalf = tan( ToRadians( r_fov.GetVal() * 0.5f ) );
+        float pixelsPerRadian = h / ( 2.0f * tanHalf );
+        
+        float degrees = fabs( app_latitude.GetVal() - dv.latitude );
+        degrees = max( degrees, fabs( ModuloRange( app_longitude.GetVal() - dv.longitude, -180, 180 ) ) );
+        if ( appMode == AppMode_ViewGlobe ) {
+            degrees = max( degrees, fabs( globeViewLat - dv.globeLat ) );
+            degrees = max( degrees, fabs( ModuloRange( globeViewLon - dv.globeLon, -180, 180 ) ) );
+        }
+        float radians = max( ToRadians( degrees ), AxisAngle( orientation, dv.orientation ) );
+        // the sky turns with the earth
+        radians = max( radians, fabs( app_phaseEarthRotation.GetVal() - dv.phase ) );
+        
+        float fovPixels = 0.5f * h * fabs( 1.0f - tan( ToRadians( dv.fov * 0.5f ) ) / tanHalf );
+        return max( radians * pixelsPerRadian, fovPixels );
+    }
+    
+    // labels and figures fading in or out, or holding until they fade
+    bool DynamicsAnimating() {
+        for ( map< string, DynamicLabel >::iterator it = dynamicLabels.begin(); it != dynamicLabels.end(); ++it ) {
+            if ( it->second.state != DynamicRenderable::DState_Terminate ) {
+                return true;
+            }
+        }
+        for ( map< Lines *, DynamicLines >::iterator it = dynamicLines.begin(); it != dynamicLines.end(); ++it ) {
+            if ( it->second.state != DynamicRenderable::DState_Terminate ) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool NeedsDisplay() {
+        PrepareFrame();
+        framePrepared = true;
+        // always take the request, so it does not linger into a later frame
+        bool requested = RedrawRequested();
+        if ( requested || app_redrawAlways.GetVal() || drawnView.valid == false ||
+             drawnView.mode != appMode ||
+             drawnView.width != r_windowWidth.GetVal() || drawnView.height != r_windowHeight.GetVal() ||
+             DynamicsAnimating() || ViewMotionPixels() > app_redrawPixels.GetVal() ) {
+            return true;
+        }
+        framePrepared = false;
+        app_framesSkipped.SetVal( app_framesSkipped.GetVal() + 1 );
+        return false;
+    }
+    
+    void Display() {
+        ProfileScope ps( displayTimer );
+        if ( framePrepared == false ) {
+            PrepareFrame();
+        }
+        framePrepared = false;
+        RememberView();
+        app_framesDrawn.SetVal( app_framesDrawn.GetVal() + 1 );
 		
         switch ( appMode ) {
         case AppMode_ViewStars:
@@ -1123,6 +1799,7 @@ namespace star3map {
         default:
             break;
         }
+        FlushSprites();
 
         // UI
         PlaceButtons();
@@ -1139,7 +1816,327 @@ namespace star3map {
         PopTransform(); // 0
         BlendDisable();
 		
-    }		
+    }
+    
+    // benchmark command - draws one view back to back and reports the CPU
+    // time per frame, along with draws and uploads when r_backend is "record"
+    void Benchmark( const vector< Token > & tokens ) {
+        int frames = 100;
+        AppModeEnum mode = appMode;
+        if ( tokens.size() > 1 && tokens[1].type == TokenType_Number ) {
+            frames = max( 1, int( tokens[1].valNumber ) );
+        }
+        if ( tokens.size() > 2 ) {
+            if ( tokens[2].valString == "stars" ) {
+                mode = AppMode_ViewStars;
+            } else if ( tokens[2].valString == "globe" ) {
+                mode = AppMode_ViewGlobe;
+            } else {
+                Output( "usage: benchmark [frames] [stars|globe]" );
+                return;
+            }
+        }
+        
+        UpdateStarEpoch();
+        Initialize();
+        orientation = app_useCompass.GetVal() ? platformOrientation : manualOrientation;
+        UpdateLatLon();
+        
+        double total = 0.0;
+        double fastest = 0.0;
+        double slowest = 0.0;
+        double draws = 0.0;
+        double verts = 0.0;
+        double bytes = 0.0;
+        for ( int i = 0; i < frames; i++ ) {
+            RecordClear();
+            double t0 = GetTime();
+            if ( mode == AppMode_ViewGlobe ) {
+                DisplayViewGlobe();
+            } else {
+                DisplayViewStars();
+            }
+            FlushSprites();
+            double dt = GetTime() - t0;
+            ProfileFrame();
+            total += dt;
+            fastest = i == 0 ? dt : min( fastest, dt );
+            slowest = max( slowest, dt );
+            const RecordStats & rs = GetRecordStats();
+            draws += rs.draws;
+            verts += rs.verts;
+            bytes += rs.bytesUploaded;
+        }
+        Output( "benchmark: %d %s frames, avg %.3f ms, min %.3f ms, max %.3f ms",
+               frames, mode == AppMode_ViewGlobe ? "globe" : "stars",
+               1000.0 * total / frames, 1000.0 * fastest, 1000.0 * slowest );
+        if ( Recording() ) {
+            Output( "benchmark: per frame %.1f draws, %.0f verts, %.0f bytes uploaded",
+                   draws / frames, verts / frames, bytes / frames );
+        }
+    }
+    CommandFunc BenchmarkCmd( "benchmark", "benchmark [frames] [stars|globe] - times back to back frames of one view", Benchmark );
+}
+
+namespace {
+    
+    // window position of dir under mvp, false if it is behind the viewer
+    bool ProjectToScene( const SkyScene & scene, const Matrix4f & mvp, const Vec3f & dir, Vec2f & win ) {
+        Vec4f c = mvp * Vec4f( dir.x, dir.y, dir.z, 1 );
+        if ( c.w <= 0.0f ) {
+            return false;
+        }
+        win.x = ( c.x / c.w * 0.5f + 0.5f ) * scene.Width();
+        win.y = ( c.y / c.w * 0.5f + 0.5f ) * scene.Height();
+        return true;
+    }
+    
+    bool InScene( const SkyScene & scene, const Vec2f & win, float margin ) {
+        return win.x > -margin && win.y > -margin && win.x < scene.Width() + margin && win.y < scene.Height() + margin;
+    }
+    
+    // orders star indexes brightest first
+    struct BrighterStar {
+        bool operator() ( int a, int b ) const {
+            return stars[a].magnitude < stars[b].magnitude;
+        }
+    };
+    
+}
+
+namespace star3map {
+    
+    void LoadSky( Texture2D * startex ) {
+        float starColors [] = {
+            0.8, 0.8, 1.0, // blue
+            1.0, 1.0, 0.8, // light yellow
+            1.0, 1.0, 0.6, // yellow
+            1.0, 0.8, 0.4, // orange
+            1.0, 0.6, 0.3  // red
+        };
+        vector< star3map::Star > sl;
+        ReadStarList( "stars.txt", sl );
+        BuildStarCatalog( sl, starCatalog );
+        map<int, star3map::Star *> sm;
+        for ( int i = 0; i < (int)sl.size(); i++ ) {
+            Sprite sp;
+            star3map::Star & st = sl[i];
+            sm[ st.hipnum ] = & st;
+            sp.direction = starCatalog.direction[ i ];
+            sp.magnitude = st.mag;
+            sp.scale = 1.0f;
+            sp.tex = startex;
+            sp.name = st.name;
+            float f = 3.99f * max( 0.f, min( 1.0f, float( ( st.colorIndex + 0.29 ) / ( 1.41 + 0.29 ) )  ) );
+            int ind = f;
+            float phase = f - ind;
+            ind *= 3;
+            Vec3f c0( starColors + ind );
+            Vec3f c1( starColors + ind + 3 );
+            Vec3f c = c0 * ( 1 - phase ) + c1 * phase;
+            sp.color = Vec4f( c.x, c.y, c.z, 1 );
+            stars.push_back( sp );
+        }
+        vector< star3map::Constellation > cl;
+        ReadConstellations( "constellations.txt", cl );
+        for( int i = 0; i < (int)cl.size(); i++ ) {
+            star3map::Constellation & c = cl[ i ];
+            star3map::Lines lines;
+            lines.name = c.name;
+            lines.center = Vec3f( 0, 0, 0 );
+            for ( int j = 0; j < (int)c.indexes.size(); j+=2 ) {
+                if ( sm.count( c.indexes[ j + 0 ] ) && sm.count( c.indexes[j + 1 ] ) ) {
+                    for ( int k = 0; k < 2; k++ ) {
+                        int si = int( sm[ c.indexes[ j + k ] ] - & sl[0] );
+                        lines.star.push_back( si );
+                        lines.vert.push_back( starCatalog.direction[ si ] );
+                        lines.center += lines.vert.back();
+                    }
+                } else {
+                    Output( "One of the following constellation indexes was not found: %d, %d.", c.indexes[j], c.indexes[j+1] );
+                }
+            }
+            lines.center.Normalize();
+            lines.limit = 1.0f;
+            for ( int j = 0; j < (int)lines.vert.size(); j++ ) {
+                lines.limit = min( lines.limit, lines.center.Dot( lines.vert[ j ] ) );
+            }
+            constellations.push_back( lines );
+        }
+    }
+    
+    Matrix4f ManualOrientation( float phi, float theta ) {
+        Matrix4f phiMat = Rotationf( Vec3f( 1, 0, 0 ), -ToRadians( phi + 90 ) ).GetMatrix4();
+        Matrix4f thetaMat = Rotationf( Vec3f( 0, 0, 1 ), -ToRadians( theta ) ).GetMatrix4();
+        return phiMat * thetaMat;
+    }
+    
+    void CaptureSkyScene( SkyScene & scene, const Matrix4f & view, float fov ) {
+        UpdateStarEpoch();
+        Initialize();
+        
+        Matrix4f proj = Perspective( fov, float( scene.Width() ) / scene.Height(), 0.5f, 100.0f );
+        Matrix4f comp = ComputeStarFrame();
+        Matrix4f axis = Rotationf( Vec3f( 1, 0, 0 ), ToRadians( 23.0 ) ).GetMatrix4();
+        Matrix4f mvp = proj * view * comp;
+        Matrix4f solarMvp = mvp * axis;
+        // sprites are sized in units at unit distance, as in DrawStars()
+        float pixelsPerUnit = scene.Height() / ( 2.0f * tan( ToRadians( fov * 0.5f ) ) );
+        float spriteScale = app_starScale.GetVal() * app_scale.GetVal() * pixelsPerUnit;
+        
+        // constellation figures, clipped to the near side of the viewer
+        Vec4f lineColor( .5, .5, .7, .5 );
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            Lines & l = constellations[i];
+            for ( int j = 0; j + 1 < (int)l.vert.size(); j += 2 ) {
+                Vec4f a = mvp * Vec4f( l.vert[j].x, l.vert[j].y, l.vert[j].z, 1 );
+                Vec4f b = mvp * Vec4f( l.vert[j+1].x, l.vert[j+1].y, l.vert[j+1].z, 1 );
+                const float nearW = 1e-3f;
+                if ( a.w < nearW && b.w < nearW ) {
+                    continue;
+                }
+                if ( a.w < nearW || b.w < nearW ) {
+                    float t = ( nearW - a.w ) / ( b.w - a.w );
+                    Vec4f m = a + ( b - a ) * t;
+                    ( a.w < nearW ? a : b ) = m;
+                }
+                Vec2f wa( ( a.x / a.w * 0.5f + 0.5f ) * scene.Width(), ( a.y / a.w * 0.5f + 0.5f ) * scene.Height() );
+                Vec2f wb( ( b.x / b.w * 0.5f + 0.5f ) * scene.Width(), ( b.y / b.w * 0.5f + 0.5f ) * scene.Height() );
+                scene.AddLine( wa, wb, lineColor );
+            }
+        }
+        
+        // stars
+        const SkyImage *starImage = stars.size() && stars[0].tex ? GetSkyImage( stars[0].tex->Name() ) : NULL;
+        vector< int > named;
+        for ( int i = 0; i < (int)stars.size(); i++ ) {
+            Sprite & s = stars[i];
+            if ( s.magnitude > 4 ) {
+                continue;
+            }
+            Vec2f win;
+            float radius = 10.0f * s.scale * GetSpriteDiameter( s.magnitude ) * spriteScale;
+            if ( ProjectToScene( scene, mvp, s.direction, win ) == false || InScene( scene, win, radius ) == false ) {
+                continue;
+            }
+            scene.AddSprite( starImage, win, radius, s.color * GetSpriteColorScale( s.magnitude ) );
+            if ( s.name.size() > 0 && s.magnitude < 2.5 ) {
+                named.push_back( i );
+            }
+        }
+        
+        // planets, in the tilted solar system frame
+        for ( int i = 0; i < (int)solarsystem.size(); i++ ) {
+            Sprite & s = solarsystem[i];
+            Vec2f win;
+            float radius = 10.0f * s.scale * spriteScale;
+            if ( s.tex == NULL || ProjectToScene( scene, solarMvp, s.direction, win ) == false || InScene( scene, win, radius ) == false ) {
+                continue;
+            }
+            scene.AddSprite( GetSkyImage( s.tex->Name() ), win, radius, s.color );
+        }
+        
+        // labels, most important first since overlapping ones are dropped
+        for ( int i = 0; i < (int)solarsystem.size(); i++ ) {
+            Sprite & s = solarsystem[i];
+            Vec2f win;
+            if ( ProjectToScene( scene, solarMvp, s.direction, win ) && InScene( scene, win, 0 ) ) {
+                scene.AddLabel( s.name, win - Vec2f( 0, 10.0f * s.scale * spriteScale ), Vec4f( 1, 1, 1, 1 ) );
+            }
+        }
+        for ( int i = 0; i < (int)constellations.size(); i++ ) {
+            Lines & l = constellations[i];
+            Vec2f win;
+            if ( ProjectToScene( scene, mvp, l.center, win ) && InScene( scene, win, 0 ) ) {
+                scene.AddLabel( l.name, win, Vec4f( .5, .5, .7, .8 ) );
+            }
+        }
+        sort( named.begin(), named.end(), BrighterStar() );
+        for ( int i = 0; i < (int)named.size(); i++ ) {
+            Sprite & s = stars[ named[i] ];
+            Vec2f win;
+            ProjectToScene( scene, mvp, s.direction, win );
+            scene.AddLabel( s.name, win - Vec2f( 0, 10.0f * s.scale * GetSpriteDiameter( s.magnitude ) * spriteScale ), Vec4f( 1, 1, 1, 1 ) );
+        }
+    }
+    
+    bool PickDirection( int x, int y, Vec3f & dir ) {
+        if ( pickValid == false ) {
+            return false;
+        }
+        Vec3f ndc( 2.0f * ( x + 0.5f ) / r_windowWidth.GetVal() - 1.0f,
+                   2.0f * ( y + 0.5f ) / r_windowHeight.GetVal() - 1.0f, -1.0f );
+        dir = pickImvp * ndc;
+        dir.Normalize();
+        return true;
+    }
+    
+    int PickConstellation( int x, int y ) {
+        Vec3f dir;
+        return PickDirection( x, y, dir ) ? constellationGrid.Lookup( dir ) : -1;
+    }
+    
+    int Pick( int x, int y, float radius, vector< PickResult > & results, int maxResults ) {
+        Vec3f pickDir;
+        if ( PickDirection( x, y, pickDir ) == false ) {
+            return 0;
+        }
+        float r = ToRadians( radius );
+        float minDot = cos( r );
+        
+        vector< PickResult > found;
+        vector< int > nearby;
+        starIndex.Query( pickDir, r, nearby );
+        for ( int i = 0; i < (int)nearby.size(); i++ ) {
+            int si = nearby[i];
+            Sprite & s = stars[ si ];
+            // as BuildStarsModel, fainter stars are not drawn
+            if ( s.magnitude > 4 ) {
+                continue;
+            }
+            string name = s.name;
+            if ( name.size() == 0 && si < (int)starCatalog.hipnum.size() && starCatalog.hipnum[ si ] > 0 ) {
+                char hip[32];
+                r3Sprintf( hip, "HIP %d", starCatalog.hipnum[ si ] );
+                name = hip;
+            }
+            if ( name.size() == 0 ) {
+                continue;
+            }
+            AddPickResult( found, ObjectHandle( ObjectType_Star, si ), name, s.direction, s.magnitude, pickDir );
+        }
+        
+        // the solar system is drawn tilted to the ecliptic
+        Matrix4f axis = Rotationf( Vec3f( 1, 0, 0 ), ToRadians( 23.0 ) ).GetMatrix4();
+        for ( int i = 0; i < (int)solarsystem.size(); i++ ) {
+            Sprite & s = solarsystem[i];
+            Vec3f dir = axis * s.direction;
+            if ( pickDir.Dot( dir ) >= minDot ) {
+                AddPickResult( found, ObjectHandle( ObjectType_SolarSystem, i ), s.name, dir, s.magnitude, pickDir );
+            }
+        }
+        
+        if ( app_showSatellites.GetVal() && satellite.size() > 0 ) {
+            float latitude = ToRadians( app_latitude.GetVal() );
+            float longitude = ToRadians( app_longitude.GetVal() );
+            Matrix4f invPhase = Rotationf( Vec3f( 0, 0, 1 ), GetCurrentEarthPhase() ).GetMatrix4();
+            Vec3f viewer = invPhase * SphericalToCartesian( 6371, latitude, longitude );
+            for ( int i = 0; i < (int)satellite.size(); i++ ) {
+                Vec3f dir = satellite[ i ].pos - viewer;
+                dir.Normalize();
+                if ( pickDir.Dot( dir ) >= minDot ) {
+                    // no magnitude in the TLE data, rank them with the bright stars
+                    AddPickResult( found, ObjectHandle( ObjectType_Satellite, i ), satellite[ i ].name, dir, 2.0f, pickDir );
+                }
+            }
+        }
+        
+        sort( found.begin(), found.end(), ComparePickResult );
+        int count = min( maxResults, (int)found.size() );
+        results.insert( results.end(), found.begin(), found.begin() + count );
+        return count;
+    }
+    
 }
 
 
@@ -45,12 +45,55 @@
 
 #include "render.h"
 #include "starlist.h"
+#include "nameindex.h"
+
+#include <string>
+#include <vector>
 
 namespace star3map {
 
+    // Reads stars.txt and constellations.txt into the star sprites, the
+    // star catalog and the constellation figures.  Every star is drawn
+    // with startex.
+    void LoadSky( r3::Texture2D * startex );
+    
+    // Returns false when the frame would look the same as the last one
+    // drawn, so the platform can leave that one on screen.  Call it right
+    // before Display().
+    bool NeedsDisplay();
     void Display();	
     bool ProcessInput( bool active, int x, int y );
     
+    struct PickResult {
+        ObjectHandle handle;
+        std::string name;
+        r3::Vec3f direction;  // in the star frame
+        float magnitude;
+        float angle;          // radians from the pick direction
+    };
+    
+    // Finds the objects within radius (degrees) of window position x, y
+    // (origin at lower left) in the last star view drawn, brightest first.
+    // Only stars that are drawn are found, and unnamed ones are called by
+    // their HIP number.
+    int Pick( int x, int y, float radius, std::vector< PickResult > & results, int maxResults = 8 );
+    
+    // Window position to a unit direction in the star frame.
+    bool PickDirection( int x, int y, r3::Vec3f & dir );
+    
+    // Index of the constellation containing window position x, y, or -1.
+    int PickConstellation( int x, int y );
+    
+    // The view app_manualPhi and app_manualTheta (degrees) select.
+    r3::Matrix4f ManualOrientation( float phi, float theta );
+    
+    class SkyScene;
+    
+    // Fills scene with an offscreen chart of the star view for the current
+    // time and location: constellation figures, stars, planets and labels,
+    // seen through view with a vertical field of view of fov degrees.
+    void CaptureSkyScene( SkyScene & scene, const r3::Matrix4f & view, float fov );
+    
     inline float ModuloRange( float f, float lower, float upper ) {
         float delta = upper - lower;
         float fndiff = ( f - lower ) / delta;
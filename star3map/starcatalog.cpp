@@ -0,0 +1,135 @@
+/*
+ *  starcatalog
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#include "starcatalog.h"
+
+#include "r3/output.h"
+#include "r3/var.h"
+
+#include <math.h>
+
+using namespace std;
+using namespace r3;
+
+VarFloat app_epochUpdateDays( "app_epochUpdateDays", "days the display epoch may drift before the star catalog is re-precessed", 0, 30.0f );
+
+namespace {
+    const double ArcsecToRadians = R3_PI / ( 180.0 * 3600.0 );
+    const double MasToRadians = ArcsecToRadians / 1000.0;
+    const float DaysPerYear = 365.25f;
+}
+
+namespace star3map {
+	
+    void BuildStarCatalog( const vector<Star> & list, StarCatalog & catalog ) {
+        int n = (int)list.size();
+        catalog.hipnum.resize( n );
+        catalog.ra.resize( n );
+        catalog.dec.resize( n );
+        catalog.pmRa.resize( n );
+        catalog.pmDec.resize( n );
+        catalog.direction.resize( n );
+        for ( int i = 0; i < n; i++ ) {
+            const Star & s = list[i];
+            catalog.hipnum[i] = s.hipnum;
+            catalog.ra[i] = ToRadians( s.ra );
+            catalog.dec[i] = ToRadians( s.dec );
+            catalog.pmRa[i] = float( s.pmRa * MasToRadians );
+            catalog.pmDec[i] = float( s.pmDec * MasToRadians );
+        }
+        catalog.valid = false;
+        UpdateStarCatalogEpoch( catalog, 0.0f );
+    }
+    
+    Matrix3f PrecessionMatrix( float yearsSinceJ2000 ) {
+        double T = yearsSinceJ2000 / 100.0;
+        double zeta  = ( 2306.2181 * T + 0.30188 * T * T + 0.017998 * T * T * T ) * ArcsecToRadians;
+        double z     = ( 2306.2181 * T + 1.09468 * T * T + 0.018203 * T * T * T ) * ArcsecToRadians;
+        double theta = ( 2004.3109 * T - 0.42665 * T * T - 0.041833 * T * T * T ) * ArcsecToRadians;
+        double cz = cos( zeta ), sz = sin( zeta );
+        double cZ = cos( z ), sZ = sin( z );
+        double ct = cos( theta ), st = sin( theta );
+        Matrix3f m;
+        m(0,0) =  cz * cZ * ct - sz * sZ;
+        m(0,1) = -sz * cZ * ct - cz * sZ;
+        m(0,2) = -cZ * st;
+        m(1,0) =  cz * sZ * ct + sz * cZ;
+        m(1,1) = -sz * sZ * ct + cz * cZ;
+        m(1,2) = -sZ * st;
+        m(2,0) =  cz * st;
+        m(2,1) = -sz * st;
+        m(2,2) =  ct;
+        return m;
+    }
+    
+    bool UpdateStarCatalogEpoch( StarCatalog & catalog, float yearsSinceJ2000 ) {
+        float threshold = app_epochUpdateDays.GetVal() / DaysPerYear;
+        if ( catalog.valid && fabs( yearsSinceJ2000 - catalog.epoch ) < threshold ) {
+            return false;
+        }
+        
+        Matrix3f p = PrecessionMatrix( yearsSinceJ2000 );
+        float t = yearsSinceJ2000;
+        int n = catalog.Size();
+        const float *ra = n ? &catalog.ra[0] : NULL;
+        const float *dec = n ? &catalog.dec[0] : NULL;
+        const float *pmRa = n ? &catalog.pmRa[0] : NULL;
+        const float *pmDec = n ? &catalog.pmDec[0] : NULL;
+        Vec3f *dir = n ? &catalog.direction[0] : NULL;
+        
+        // one pass over the arrays, no per star allocation or branching
+        for ( int i = 0; i < n; i++ ) {
+            float d = dec[i] + pmDec[i] * t;
+            float cd = cosf( dec[i] );
+            float r = ra[i] + pmRa[i] * t / max( cd, 1e-6f );
+            float cosd = cosf( d );
+            Vec3f v( cosd * cosf( r ), cosd * sinf( r ), sinf( d ) );
+            dir[i] = p * v;
+        }
+        
+        catalog.epoch = yearsSinceJ2000;
+        catalog.valid = true;
+        Output( "Star catalog moved to epoch J%.2f", 2000.0f + yearsSinceJ2000 );
+        return true;
+    }
+    
+}
@@ -0,0 +1,89 @@
+/*
+ *  starcatalog
+ */
+
+/* 
+ Copyright (c) 2010 Cass Everitt
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or
+ without modification, are permitted provided that the following
+ conditions are met:
+ 
+ * Redistributions of source code must retain the above
+ copyright notice, this list of conditions and the following
+ disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above
+ copyright notice, this list of conditions and the following
+ disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ * The names of contributors to this software may not be used
+ to endorse or promote products derived from this software
+ without specific prior written permission. 
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ POSSIBILITY OF SUCH DAMAGE. 
+ 
+ 
+ Cass Everitt
+ */
+
+#ifndef __STAR3MAP_STARCATALOG_H__
+#define __STAR3MAP_STARCATALOG_H__
+
+#include "starlist.h"
+#include "r3/linear.h"
+
+#include <string>
+#include <vector>
+
+namespace star3map {
+	
+    // Structure of arrays copy of the star list at the catalog epoch (J2000),
+    // plus the unit vectors for the epoch currently being displayed.
+    struct StarCatalog {
+        StarCatalog() : epoch( 0.0f ), valid( false ) {}
+        std::vector< int > hipnum;
+        std::vector< float > ra;      // radians
+        std::vector< float > dec;     // radians
+        std::vector< float > pmRa;    // radians per year, includes cos( dec )
+        std::vector< float > pmDec;   // radians per year
+        std::vector< r3::Vec3f > direction;  // unit vectors at epoch
+        float epoch;                  // years since J2000 that direction was computed for
+        bool valid;
+        
+        int Size() const {
+            return (int)ra.size();
+        }
+        int Bytes() const {
+            return (int)( hipnum.capacity() * sizeof( int ) +
+                          ( ra.capacity() + dec.capacity() + pmRa.capacity() + pmDec.capacity() ) * sizeof( float ) +
+                          direction.capacity() * sizeof( r3::Vec3f ) );
+        }
+    };
+    
+    void BuildStarCatalog( const std::vector<Star> & list, StarCatalog & catalog );
+    
+    // Applies proper motion and precession from J2000 to the given epoch for
+    // the whole catalog.  Does nothing and returns false if the epoch has moved
+    // by less than app_epochUpdateDays since the last update.
+    bool UpdateStarCatalogEpoch( StarCatalog & catalog, float yearsSinceJ2000 );
+    
+    // IAU 1976 precession, equatorial J2000 to mean equator and equinox of date.
+    r3::Matrix3f PrecessionMatrix( float yearsSinceJ2000 );
+    
+}
+
+#endif //__STAR3MAP_STARCATALOG_H__
@@ -57,7 +57,11 @@ namespace star3map {
         while ( file->AtEnd() == false ) {
             string line = file->ReadLine();
             vector< Token > tokens = TokenizeString( line.c_str() );
-            if ( ( tokens.size() == 6 ) &&
+            // optional trailing proper motion columns
+            bool hasProperMotion = tokens.size() == 8 &&
+                tokens[6].type == TokenType_Number &&  // pm ra
+                tokens[7].type == TokenType_Number;    // pm dec
+            if ( ( tokens.size() == 6 || hasProperMotion ) &&
                  tokens[0].type == TokenType_Number &&  // HIP number
                  tokens[1].type == TokenType_String &&  // common name
                  tokens[2].type == TokenType_Number &&  // magnitude
@@ -76,6 +80,8 @@ namespace star3map {
                 s.ra *= 180.0f;
                 s.dec = tokens[4].valNumber;
                 s.colorIndex = tokens[5].valNumber;
+                s.pmRa = hasProperMotion ? tokens[6].valNumber : 0.0f;
+                s.pmDec = hasProperMotion ? tokens[7].valNumber : 0.0f;
                 list.push_back( s );
             }
         }
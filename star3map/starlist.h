@@ -54,6 +54,8 @@ namespace star3map {
         float ra;
         float dec;
         float colorIndex;
+        float pmRa;  // proper motion in mas/yr, includes cos( dec )
+        float pmDec; // proper motion in mas/yr
         std::string name;
     };
     